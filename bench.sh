@@ -0,0 +1,24 @@
+#!/bin/bash
+###Sweep the cache and summary sizes and collect the [BENCH] lines
+###usage: ./bench.sh [native|OrisenPrime] [output file]
+###On OrisenPrime each size is flashed with dtn.upload and the lines must be
+###collected from the serial console instead.
+target=${1:-native}
+file=${2:-bench_output.txt}
+sizes="5 10 20 50 100 200 400"
+> $file
+for msgs in $sizes;
+do
+    for vec in 5 $msgs;
+    do
+        make TARGET=$target clean > /dev/null
+        make TARGET=$target DTN_BENCH=1 DTN_BENCH_MESSAGES=$msgs DTN_BENCH_VECTORS=$vec > /dev/null || exit 1
+        if [ "$target" = "native" ]; then
+            ./dtn.native | grep -a "BENCH" >> $file
+        else
+            make TARGET=$target DTN_BENCH=1 DTN_BENCH_MESSAGES=$msgs DTN_BENCH_VECTORS=$vec dtn.upload
+            read -p "Collect the [BENCH] lines for msgs $msgs vec $vec, then press enter"
+        fi
+        [ "$vec" = "$msgs" ] && break
+    done
+done
@@ -0,0 +1,6 @@
+#!/bin/bash
+###Pull the [CAP] records out of a serial log and write them as a binary capture
+###usage: ./capture.sh log.out dtn.cap
+log=$1
+out=${2:-dtn.cap}
+cat $log|grep -a "\[CAP\]"|sed 's/.*\[CAP\] //'|tr -d '\r'|xxd -r -p > $out
@@ -0,0 +1,111 @@
+/**
+ * @file dtn-adapt.c
+ * @author Archie Norman
+ * @brief Network size and encounter rate estimates for sizing L.
+ */
+#include "dtn-adapt.h"
+#include <stdio.h>
+
+#if DTN_ADAPT
+#define SLOT_LENGTH (DTN_ADAPT_WINDOW / DTN_ADAPT_SLOTS)
+///Fixed point scale for the harmonic sums
+#define SCALE 1024UL
+static struct {
+  rimeaddr_t addr;
+  unsigned long last_seen;
+} peers[DTN_ADAPT_PEERS];
+///Encounters per slot of the window, and the slot we are counting in
+static uint16_t encounters[DTN_ADAPT_SLOTS];
+static unsigned long current_slot;
+/*
+ * @brief Move the window on to the current slot, clearing the slots it passed
+ */
+static void
+advance(unsigned long now)
+{
+  unsigned long slot = now / SLOT_LENGTH;
+  while(current_slot < slot) {
+    current_slot++;
+    encounters[current_slot % DTN_ADAPT_SLOTS] = 0;
+    if(slot - current_slot >= DTN_ADAPT_SLOTS) {
+      current_slot = slot - DTN_ADAPT_SLOTS;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_adapt_beacon(const rimeaddr_t *from)
+{
+  unsigned long now = clock_seconds();
+  int i, oldest = 0;
+
+  advance(now);
+  for(i = 0; i < DTN_ADAPT_PEERS; i++) {
+    if(peers[i].last_seen != 0 && rimeaddr_cmp(&peers[i].addr, from)) {
+      break;
+    }
+    if(peers[i].last_seen < peers[oldest].last_seen) {
+      oldest = i;
+    }
+  }
+  if(i == DTN_ADAPT_PEERS) {
+    ///Not heard recently enough to still be in the table, a new encounter
+    i = oldest;
+    rimeaddr_copy(&peers[i].addr, from);
+    encounters[current_slot % DTN_ADAPT_SLOTS]++;
+  }
+  else if(now - peers[i].last_seen > DTN_ADAPT_GAP) {
+    encounters[current_slot % DTN_ADAPT_SLOTS]++;
+  }
+  ///Zero means an empty entry, so the first second counts as one
+  peers[i].last_seen = now ? now : 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+dtn_adapt_copies(void)
+{
+  unsigned long now = clock_seconds(), seen, delay, span;
+  unsigned long harmonic, wait;
+  int i, m, l, cap;
+
+  advance(now);
+  ///M counts the distinct neighbours heard within the window and us
+  m = 1;
+  for(i = 0; i < DTN_ADAPT_PEERS; i++) {
+    if(peers[i].last_seen != 0 && now - peers[i].last_seen < DTN_ADAPT_WINDOW) {
+      m++;
+    }
+  }
+  seen = 0;
+  for(i = 0; i < DTN_ADAPT_SLOTS; i++) {
+    seen += encounters[i];
+  }
+  if(m < 2 || seen == 0) {
+    return DTN_ADAPT_DEFAULT;
+  }
+  ///Early on the window is not full yet
+  span = now < DTN_ADAPT_WINDOW ? (now ? now : 1) : DTN_ADAPT_WINDOW;
+  cap = m < DTN_ADAPT_MAX_COPIES ? m : DTN_ADAPT_MAX_COPIES;
+  /*
+   *1/lambda = (M-1) span / seen, so
+   *ED(L) = span / seen * ((H(M-1) - H(M-L)) + (M-L) / L)
+   *harmonic builds H(M-1) - H(M-L) up one term per L
+   */
+  harmonic = 0;
+  for(l = 1; l <= cap; l++) {
+    if(l > 1) {
+      harmonic += SCALE / (m - l + 1);
+    }
+    wait = SCALE * (m - l) / l;
+    delay = span * (harmonic + wait) / (seen * SCALE);
+    if(delay <= DTN_ADAPT_TARGET) {
+      break;
+    }
+  }
+  if(l > cap) {
+    l = cap;
+  }
+  PRINTF("--- [ADAPT] M %d, %lu encounters in %lus, L %d\n", m, seen, span, l);
+  return l;
+}
+#endif /* DTN_ADAPT */
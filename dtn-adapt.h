@@ -0,0 +1,76 @@
+/**
+ * @file dtn-adapt.h
+ * @author Archie Norman
+ * @brief Adaptive initial copy count. Beacons are used to estimate how many
+ * distinct nodes are around (M, counting ourselves) and how often we
+ * encounter one (a neighbour heard again after more than DTN_ADAPT_GAP of
+ * silence counts as a new encounter), both over a sliding window of
+ * DTN_ADAPT_WINDOW. New bundles get the smallest L whose expected delay
+ * under Spray and Wait meets DTN_ADAPT_TARGET:
+ *
+ *   ED(L) = 1/lambda * ((H(M-1) - H(M-L)) / (M-1) + (M-L) / ((M-1) L))
+ *
+ * with H the harmonic numbers and lambda the per pair meeting rate, which is
+ * our encounter rate divided by M-1. L is capped at DTN_ADAPT_MAX_COPIES and
+ * at M. Until there is something to go on bundles get DTN_ADAPT_DEFAULT.
+ * Enable with DTN_CONF_ADAPT in project-conf.h.
+ */
+#ifndef __DTN_ADAPT_H__
+#define __DTN_ADAPT_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_ADAPT
+#define DTN_ADAPT DTN_CONF_ADAPT
+#else
+#define DTN_ADAPT 0
+#endif
+///Expected delay we size L for, in seconds
+#ifdef DTN_ADAPT_CONF_TARGET
+#define DTN_ADAPT_TARGET DTN_ADAPT_CONF_TARGET
+#else
+#define DTN_ADAPT_TARGET 300
+#endif
+///Upper bound on L
+#ifdef DTN_ADAPT_CONF_MAX_COPIES
+#define DTN_ADAPT_MAX_COPIES DTN_ADAPT_CONF_MAX_COPIES
+#else
+#define DTN_ADAPT_MAX_COPIES 16
+#endif
+///L used before any encounters have been seen, the old fixed value
+#ifdef DTN_ADAPT_CONF_DEFAULT
+#define DTN_ADAPT_DEFAULT DTN_ADAPT_CONF_DEFAULT
+#else
+#define DTN_ADAPT_DEFAULT 1
+#endif
+///Sliding window for the estimates in seconds, and the number of slots it moves in
+#ifdef DTN_ADAPT_CONF_WINDOW
+#define DTN_ADAPT_WINDOW DTN_ADAPT_CONF_WINDOW
+#else
+#define DTN_ADAPT_WINDOW 600
+#endif
+#define DTN_ADAPT_SLOTS 10
+///Silence in seconds after which hearing a neighbour again is a new encounter,
+///a few beacon periods (raise it along with DTN_ANNOUNCE_FALLBACK)
+#ifdef DTN_ADAPT_CONF_GAP
+#define DTN_ADAPT_GAP DTN_ADAPT_CONF_GAP
+#else
+#define DTN_ADAPT_GAP 20
+#endif
+///Distinct neighbours tracked
+#ifdef DTN_ADAPT_CONF_PEERS
+#define DTN_ADAPT_PEERS DTN_ADAPT_CONF_PEERS
+#else
+#define DTN_ADAPT_PEERS 16
+#endif
+
+/*
+ * @brief Note a beacon from a neighbour
+ * @param1 - the neighbour
+ */
+void dtn_adapt_beacon(const rimeaddr_t *from);
+/*
+ * @brief The number of copies to give a new bundle
+ */
+uint8_t dtn_adapt_copies(void);
+
+#endif /* __DTN_ADAPT_H__ */
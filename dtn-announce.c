@@ -0,0 +1,91 @@
+/**
+ * @file dtn-announce.c
+ * @author Archie Norman
+ * @brief Cache digest announcements deciding when summary vectors are sent.
+ */
+#include "dtn-announce.h"
+#include "lib/crc16.h"
+#include <stdio.h>
+
+#if DTN_ANNOUNCE
+static struct announcement digest_announcement;
+static struct process *beacon;
+static uint16_t our_digest;
+///Set when a neighbour announced a digest we have not answered yet
+static uint8_t requested;
+static struct timer fallback;
+///The digests we last answered each neighbour with
+static struct {
+  rimeaddr_t addr;
+  uint16_t theirs;
+  uint16_t ours;
+} answered[DTN_ANNOUNCE_NEIGHBOURS];
+static uint8_t next_slot;
+/*---------------------------------------------------------------------------*/
+static void
+received_announcement(struct announcement *a, const rimeaddr_t *from,
+                      uint16_t id, uint16_t value)
+{
+  int i;
+  if(id != DTN_ANNOUNCE_ID || value == our_digest) {
+    return;
+  }
+  for(i = 0; i < DTN_ANNOUNCE_NEIGHBOURS; i++) {
+    if(rimeaddr_cmp(&answered[i].addr, from)) {
+      ///Nothing changed on either side since we last answered
+      if(answered[i].theirs == value && answered[i].ours == our_digest) {
+        return;
+      }
+      break;
+    }
+  }
+  if(i == DTN_ANNOUNCE_NEIGHBOURS) {
+    i = next_slot;
+    next_slot = (next_slot + 1) % DTN_ANNOUNCE_NEIGHBOURS;
+    rimeaddr_copy(&answered[i].addr, from);
+  }
+  answered[i].theirs = value;
+  answered[i].ours = our_digest;
+  PRINTF("--- [ANN] %d.%d digest %04x, ours %04x\n", from->u8[0], from->u8[1], value, our_digest);
+  requested = 1;
+  process_poll(beacon);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_announce_open(struct process *beacon_process)
+{
+  beacon = beacon_process;
+  announcement_register(&digest_announcement, DTN_ANNOUNCE_ID, received_announcement);
+  announcement_set_value(&digest_announcement, our_digest);
+  timer_set(&fallback, DTN_ANNOUNCE_FALLBACK);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+dtn_announce_hash(const dtn_msg_id *id)
+{
+  return crc16_data((const unsigned char *)id, sizeof(dtn_msg_id), 0);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_announce_digest(uint16_t digest)
+{
+  if(digest != our_digest) {
+    our_digest = digest;
+    announcement_set_value(&digest_announcement, digest);
+    announcement_bump(&digest_announcement);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_announce_due(void)
+{
+  return requested || timer_expired(&fallback);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_announce_sent(void)
+{
+  requested = 0;
+  timer_set(&fallback, DTN_ANNOUNCE_FALLBACK);
+}
+#endif /* DTN_ANNOUNCE */
@@ -0,0 +1,68 @@
+/**
+ * @file dtn-announce.h
+ * @author Archie Norman
+ * @brief Cache digests on Rime announcements. Rime already sends periodic
+ * announcement frames for neighbour discovery, so instead of beaconing the
+ * full summary vector every few seconds we register an announcement whose
+ * value is a 16 bit digest of the message ids in our cache. The digest does
+ * not depend on cache order, so two nodes holding the same bundles announce
+ * the same value. Only when a neighbour announces a digest different from
+ * ours is the full summary vector broadcast, and only once for each pair of
+ * digests. A slow fallback beacon keeps the custody, backpressure and time
+ * fields fresh. Enable with DTN_CONF_ANNOUNCE in project-conf.h.
+ */
+#ifndef __DTN_ANNOUNCE_H__
+#define __DTN_ANNOUNCE_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_ANNOUNCE
+#define DTN_ANNOUNCE DTN_CONF_ANNOUNCE
+#else
+#define DTN_ANNOUNCE 0
+#endif
+///Announcement id used for the digest
+#ifdef DTN_ANNOUNCE_CONF_ID
+#define DTN_ANNOUNCE_ID DTN_ANNOUNCE_CONF_ID
+#else
+#define DTN_ANNOUNCE_ID 229
+#endif
+///Neighbours whose last answered digest is remembered
+#ifdef DTN_ANNOUNCE_CONF_NEIGHBOURS
+#define DTN_ANNOUNCE_NEIGHBOURS DTN_ANNOUNCE_CONF_NEIGHBOURS
+#else
+#define DTN_ANNOUNCE_NEIGHBOURS 8
+#endif
+///Summary vectors are still broadcast this often when nothing asks for one
+#ifdef DTN_ANNOUNCE_CONF_FALLBACK
+#define DTN_ANNOUNCE_FALLBACK DTN_ANNOUNCE_CONF_FALLBACK
+#else
+#define DTN_ANNOUNCE_FALLBACK (CLOCK_SECOND * 60)
+#endif
+
+/*
+ * @brief Register the digest announcement
+ * @param1 - the process polled when a neighbour needs our summary vector
+ */
+void dtn_announce_open(struct process *beacon_process);
+/*
+ * @brief The digest contribution of one message id, a cache's digest is the
+ * sum over its ids
+ * @param1 - the message id
+ */
+uint16_t dtn_announce_hash(const dtn_msg_id *id);
+/*
+ * @brief Announce our cache digest, bumps the announcement when it changed
+ * @param1 - the digest
+ */
+void dtn_announce_digest(uint16_t digest);
+/*
+ * @brief Whether a summary vector should go out now, either a neighbour
+ * announced a different digest or the fallback beacon is due
+ */
+int dtn_announce_due(void);
+/*
+ * @brief Our summary vector went out, the requests are answered
+ */
+void dtn_announce_sent(void);
+
+#endif /* __DTN_ANNOUNCE_H__ */
@@ -0,0 +1,79 @@
+/**
+ * @file dtn-api.c
+ * @author Archie Norman
+ * @brief Endpoint registration and the dispatch of bundles and notifications
+ * to endpoints, dtn_send() is in dtn.c next to the cache.
+ */
+#include "dtn-api.h"
+#include "lib/list.h"
+#include <stdio.h>
+
+LIST(endpoints);
+/*
+ * @brief The endpoint a bundle belongs to
+ * @param1 - the bundle
+ */
+static struct dtn_endpoint *
+find(const dtn_message *message)
+{
+  struct dtn_endpoint *e, *any = NULL;
+  uint8_t id = (uint8_t)message->msg[0];
+
+  for(e = list_head(endpoints); e != NULL; e = list_item_next(e)) {
+    if(e->id == id) {
+      return e;
+    }
+    if(e->id == DTN_ENDPOINT_ANY) {
+      any = e;
+    }
+  }
+  return any;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_register(struct dtn_endpoint *endpoint)
+{
+  list_add(endpoints, endpoint);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_unregister(struct dtn_endpoint *endpoint)
+{
+  list_remove(endpoints, endpoint);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_api_receive(const dtn_message *message, const rimeaddr_t *from)
+{
+  struct dtn_endpoint *e = find(message);
+  if(e != NULL && e->receive != NULL) {
+    e->receive(message, from);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_api_delivered(const dtn_message *message)
+{
+  struct dtn_endpoint *e;
+  if(!rimeaddr_cmp(&message->hdr.message_id.src, &rimeaddr_node_addr)) {
+    return;
+  }
+  e = find(message);
+  if(e != NULL && e->delivered != NULL) {
+    e->delivered(&message->hdr.message_id);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_api_expired(const dtn_message *message)
+{
+  struct dtn_endpoint *e;
+  if(!rimeaddr_cmp(&message->hdr.message_id.src, &rimeaddr_node_addr)) {
+    return;
+  }
+  PRINTF("--- [API] Bundle %d expired before it was delivered\n", message->hdr.message_id.seq);
+  e = find(message);
+  if(e != NULL && e->expired != NULL) {
+    e->expired(&message->hdr.message_id);
+  }
+}
@@ -0,0 +1,80 @@
+/**
+ * @file dtn-api.h
+ * @author Archie Norman
+ * @brief The application side of the DTN. A firmware image sends bundles with
+ * dtn_send() and registers a struct dtn_endpoint for the bundles it wants
+ * handed to it, so the protocol can be linked in without editing dtn.c.
+ * The first payload byte names the endpoint, the same way the sample module
+ * marks its bundles with DTN_SAMPLE_MAGIC. A received bundle is passed to
+ * the endpoint where it lies, in the packet buffer or the cache, nothing is
+ * copied and it is only valid for the length of the call. The endpoint that
+ * sent a bundle is told when this node hands it to its destination, or when
+ * it is dropped here first, DTN_LIFETIME seconds after it was created or
+ * popped from a full cache. The node address is the one Rime was configured
+ * with, DTN_CONF_NODE_ADDR overrides it for test images.
+ */
+#ifndef __DTN_API_H__
+#define __DTN_API_H__
+#include "dtn.h"
+
+///Seconds a bundle is kept before it expires, 0 keeps it until it is delivered or popped
+#ifdef DTN_CONF_LIFETIME
+#define DTN_LIFETIME DTN_CONF_LIFETIME
+#else
+#define DTN_LIFETIME 0
+#endif
+///Priorities, a full cache pops the oldest of its lowest priority bundles first
+#define DTN_PRIORITY_BULK      0
+#define DTN_PRIORITY_NORMAL    1
+#define DTN_PRIORITY_EXPEDITED 2
+///An endpoint with this id is given the bundles no other endpoint takes
+#define DTN_ENDPOINT_ANY 0xff
+struct dtn_endpoint
+{
+	struct dtn_endpoint *next;
+	///The first payload byte of the bundles it takes
+	uint8_t id;
+	///A bundle for this node arrived, any of the callbacks may be NULL
+	void (* receive)(const dtn_message *message, const rimeaddr_t *from);
+	///One of our bundles was handed to its destination
+	void (* delivered)(const dtn_msg_id *id);
+	///One of our bundles expired or was popped here before it was delivered
+	void (* expired)(const dtn_msg_id *id);
+};
+/*
+ * @brief Create a bundle from this node
+ * @param1 - the destination
+ * @param2 - the payload, its first byte names the endpoint
+ * @param3 - the payload length, at most MAX_MSG_SIZE
+ * @param4 - the copies to spray, 0 for the default
+ * @param5 - one of the DTN_PRIORITY_* values
+ * @return the sequence number of the bundle, -1 if the payload is too long.
+ * It is 8 bits on the air and wraps after 255, so source, destination and
+ * number only name one bundle until the number comes round again 256 bundles later
+ */
+int dtn_send(const rimeaddr_t *dest, const void *payload, uint8_t len, uint8_t copies, uint8_t priority);
+/*
+ * @brief Start handing bundles to an endpoint
+ * @param1 - the endpoint, kept until it is unregistered
+ */
+void dtn_register(struct dtn_endpoint *endpoint);
+/*
+ * @brief Stop handing bundles to an endpoint
+ */
+void dtn_unregister(struct dtn_endpoint *endpoint);
+/*
+ * @brief Hand a bundle that reached this node to its endpoint, called by dtn.c
+ * @param1 - the bundle
+ * @param2 - the neighbour that gave it to us
+ */
+void dtn_api_receive(const dtn_message *message, const rimeaddr_t *from);
+/*
+ * @brief Tell the sending endpoint one of our bundles was delivered, called by dtn.c
+ */
+void dtn_api_delivered(const dtn_message *message);
+/*
+ * @brief Tell the sending endpoint one of our bundles expired, called by dtn.c
+ */
+void dtn_api_expired(const dtn_message *message);
+
+#endif /* __DTN_API_H__ */
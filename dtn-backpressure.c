@@ -0,0 +1,60 @@
+/**
+ * @file dtn-backpressure.c
+ * @author Archie Norman
+ * @brief Limits each transfer to what the receiver advertised it can hold.
+ */
+#include "dtn-backpressure.h"
+#include <stdio.h>
+
+#if DTN_BACKPRESSURE
+/*---------------------------------------------------------------------------*/
+int
+dtn_backpressure_room(const dtn_summary_vector *beacon)
+{
+  int room;
+  ///A node that is already popping bundles gets nothing but deliveries
+  if(beacon->flags & DTN_FLAG_CONGESTED) {
+    return 0;
+  }
+  room = beacon->free_bytes / sizeof(dtn_message);
+  if(beacon->free_slots < room) {
+    room = beacon->free_slots;
+  }
+  return room;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_backpressure_trim(dtn_message *messages, int len, const rimeaddr_t *to,
+                      const dtn_summary_vector *beacon)
+{
+  dtn_message tmp;
+  int room, deliveries, i, j;
+
+  ///Deliveries to the front, they do not use up any of the room
+  deliveries = 0;
+  for(i = 0; i < len; i++) {
+    if(rimeaddr_cmp(&messages[i].hdr.message_id.dest, to)) {
+      tmp = messages[i];
+      for(j = i; j > deliveries; j--) {
+        messages[j] = messages[j - 1];
+      }
+      messages[deliveries++] = tmp;
+    }
+  }
+  room = dtn_backpressure_room(beacon);
+  if(len - deliveries <= room) {
+    return len;
+  }
+  ///Most copies first, ties keep the cache order so older bundles go first
+  for(i = deliveries + 1; i < len; i++) {
+    tmp = messages[i];
+    for(j = i; j > deliveries && messages[j - 1].hdr.number_of_copies < tmp.hdr.number_of_copies; j--) {
+      messages[j] = messages[j - 1];
+    }
+    messages[j] = tmp;
+  }
+  PRINTF("--- [BP] %d.%d has room for %d, holding back %d\n",
+    to->u8[0], to->u8[1], room, len - deliveries - room);
+  return deliveries + room;
+}
+#endif /* DTN_BACKPRESSURE */
@@ -0,0 +1,40 @@
+/**
+ * @file dtn-backpressure.h
+ * @author Archie Norman
+ * @brief Receiver driven backpressure. Every beacon advertises how many cache
+ * slots and bytes the sender has free, and sets DTN_FLAG_CONGESTED when it
+ * has had to pop bundles since its last beacon. A node answering a beacon
+ * only sends what the neighbour can hold without popping anything. Bundles
+ * for the neighbour itself always go, they are consumed rather than cached,
+ * the rest are picked by the most copies left so the free space goes to the
+ * bundles that still have the most spraying to do. Enable with
+ * DTN_CONF_BACKPRESSURE in project-conf.h.
+ */
+#ifndef __DTN_BACKPRESSURE_H__
+#define __DTN_BACKPRESSURE_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_BACKPRESSURE
+#define DTN_BACKPRESSURE DTN_CONF_BACKPRESSURE
+#else
+#define DTN_BACKPRESSURE 0
+#endif
+
+/*
+ * @brief How many bundles a neighbour can take, from its beacon
+ * @param1 - the neighbour's summary vector
+ */
+int dtn_backpressure_room(const dtn_summary_vector *beacon);
+/*
+ * @brief Reorders the bundles picked for a neighbour and drops the ones it
+ * has no room for
+ * @param1 - the bundles picked for the neighbour
+ * @param2 - how many were picked
+ * @param3 - the neighbour
+ * @param4 - the neighbour's summary vector
+ * @return how many are left to send
+ */
+int dtn_backpressure_trim(dtn_message *messages, int len, const rimeaddr_t *to,
+                          const dtn_summary_vector *beacon);
+
+#endif /* __DTN_BACKPRESSURE_H__ */
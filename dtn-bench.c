@@ -0,0 +1,187 @@
+/**
+ * @file dtn-bench.c
+ * @author Archie Norman
+ * @brief Times the protocol hot paths against a full cache, see dtn-bench.h for
+ * the output format. Bundles are addressed to a node that is never us or the
+ * neighbour so nothing is consumed or cleaned out while we measure.
+ */
+#include "dtn-bench.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef CONTIKI_TARGET_NATIVE
+#include <stdlib.h>
+#include <time.h>
+#endif
+
+#if DTN_BENCH
+static const struct dtn_bench_hooks *bench;
+///Scratch frames, static as they get large towards the top of the sweep
+static dtn_vector bench_unicast;
+static dtn_summary_vector bench_summary;
+
+PROCESS(bench_process, "Bench process");
+
+#ifdef CONTIKI_TARGET_NATIVE
+#define BENCH_UNIT "ns_op"
+static unsigned long
+bench_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+#define bench_elapsed(t0) (bench_now() - (t0))
+#else
+#define BENCH_UNIT "rt_op"
+#define bench_now() ((unsigned long)RTIMER_NOW())
+#define bench_elapsed(t0) ((unsigned long)(rtimer_clock_t)(RTIMER_NOW() - (rtimer_clock_t)(t0)))
+#endif
+/*
+ * @brief Give each benchmark bundle a distinct id
+ * @param1 - the id to fill
+ * @param2 - the bundle number
+ */
+static void
+bench_msg_id(dtn_msg_id *id, int n)
+{
+  rimeaddr_copy(&id->src, &rimeaddr_null);
+  rimeaddr_copy(&id->dest, &rimeaddr_null);
+  id->src.u8[0] = 1 + (n >> 8);
+  id->src.u8[1] = n & 0xff;
+  id->dest.u8[0] = 128;
+  id->dest.u8[1] = 200;
+  id->seq = n >> 8;
+}
+/*
+ * @brief Put a runicast frame carrying one bundle in to the packet buffer
+ * @param1 - the bundle number
+ */
+static void
+bench_load_unicast(int n)
+{
+  memset(&bench_unicast.message[0], 0, sizeof(dtn_message));
+  bench_msg_id(&bench_unicast.message[0].hdr.message_id, n);
+  bench_unicast.message[0].hdr.number_of_copies = 8;
+  bench_unicast.message[0].hdr.timestamp = clock_seconds();
+  bench_unicast.message[0].hdr.length = 4;
+  strncpy(bench_unicast.message[0].msg, "arch", MAX_MSG_SIZE);
+  bench_unicast.header.type = DTN_MESSAGE;
+  bench_unicast.header.len = 1;
+  packetbuf_copyfrom(&bench_unicast, sizeof(dtn_vector));
+}
+/*
+ * @brief Fill the summary vector with ids starting at a bundle number
+ * @param1 - the first bundle number
+ */
+static void
+bench_load_summary(int first)
+{
+  int i;
+  for(i = 0; i < MAX_MSG_VECTORS; i++) {
+    bench_msg_id(&bench_summary.message_ids[i], first + i);
+  }
+  bench_summary.header.type = DTN_SUMMARY_VECTOR;
+  bench_summary.header.len = MAX_MSG_VECTORS;
+}
+/*
+ * @brief Print one result line
+ * @param1 - the name of the path
+ * @param2 - the total time
+ * @param3 - the number of allocations made
+ */
+static void
+bench_report(const char *path, unsigned long total, int allocs)
+{
+  printf("[BENCH] %s msgs %d vec %d iters %d " BENCH_UNIT " %lu allocs %d.%02d\n",
+    path, MAX_MESSAGES, MAX_MSG_VECTORS, DTN_BENCH_ITERATIONS,
+    total / DTN_BENCH_ITERATIONS,
+    allocs / DTN_BENCH_ITERATIONS, (allocs % DTN_BENCH_ITERATIONS) * 100 / DTN_BENCH_ITERATIONS);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_bench_start(const struct dtn_bench_hooks *hooks)
+{
+  bench = hooks;
+  process_start(&bench_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int n, allocs;
+  static unsigned long total, t0;
+  static rimeaddr_t neighbour;
+
+  PROCESS_BEGIN();
+  rimeaddr_copy(&neighbour, &rimeaddr_null);
+  neighbour.u8[0] = 128;
+  neighbour.u8[1] = 201;
+  printf("[BENCH-CONF] msgs %d vec %d iters %d rtimer_second %lu sizeof_vector %u sizeof_summary %u\n",
+    MAX_MESSAGES, MAX_MSG_VECTORS, DTN_BENCH_ITERATIONS, (unsigned long)RTIMER_SECOND,
+    (unsigned)sizeof(dtn_vector), (unsigned)sizeof(dtn_summary_vector));
+
+  ///Fill the cache, every measurement below runs against a full cache
+  for(n = 0; n < MAX_MESSAGES; n++) {
+    bench_load_unicast(n);
+    bench->uc_call->recv(bench->uc, &neighbour, 0);
+  }
+
+  ///Cache is full, every received bundle evicts the oldest one
+  allocs = *bench->allocs;
+  for(total = 0, n = 0; n < DTN_BENCH_ITERATIONS; n++) {
+    bench_load_unicast(MAX_MESSAGES + n);
+    t0 = bench_now();
+    bench->uc_call->recv(bench->uc, &neighbour, 0);
+    total += bench_elapsed(t0);
+  }
+  bench_report("recv_runicast", total, *bench->allocs - allocs);
+  PROCESS_PAUSE();
+
+  ///The neighbour already has everything we hold, the full nested comparison with no transfer
+  allocs = *bench->allocs;
+  for(total = 0, n = 0; n < DTN_BENCH_ITERATIONS; n++) {
+    bench_load_summary(MAX_MESSAGES + DTN_BENCH_ITERATIONS - MAX_MSG_VECTORS);
+    packetbuf_copyfrom(&bench_summary, sizeof(dtn_summary_vector));
+    t0 = bench_now();
+    bench->bc_call->recv(bench->bc, &neighbour);
+    total += bench_elapsed(t0);
+  }
+  bench_report("broadcast_recv_hit", total, *bench->allocs - allocs);
+  PROCESS_PAUSE();
+
+  ///The neighbour has none of our bundles, every one is packed for sending
+  allocs = *bench->allocs;
+  for(total = 0, n = 0; n < DTN_BENCH_ITERATIONS; n++) {
+    bench_load_summary(2 * (MAX_MESSAGES + DTN_BENCH_ITERATIONS));
+    packetbuf_copyfrom(&bench_summary, sizeof(dtn_summary_vector));
+    t0 = bench_now();
+    bench->bc_call->recv(bench->bc, &neighbour);
+    total += bench_elapsed(t0);
+  }
+  bench_report("broadcast_recv_miss", total, *bench->allocs - allocs);
+  PROCESS_PAUSE();
+
+  allocs = *bench->allocs;
+  for(total = 0, n = 0; n < DTN_BENCH_ITERATIONS; n++) {
+    t0 = bench_now();
+    bench->build_summary(&bench_summary);
+    total += bench_elapsed(t0);
+  }
+  bench_report("build_summary", total, *bench->allocs - allocs);
+  PROCESS_PAUSE();
+
+  ///Acknowledged by a node that is not the destination, walks the cache for the bundles of the last frame
+  allocs = *bench->allocs;
+  for(total = 0, n = 0; n < DTN_BENCH_ITERATIONS; n++) {
+    t0 = bench_now();
+    bench->uc_call->sent(bench->uc, &neighbour, 0);
+    total += bench_elapsed(t0);
+  }
+  bench_report("sent_runicast", total, *bench->allocs - allocs);
+
+  printf("[BENCH-DONE]\n");
+#ifdef CONTIKI_TARGET_NATIVE
+  exit(0);
+#endif
+  PROCESS_END();
+}
+#endif /* DTN_BENCH */
@@ -0,0 +1,48 @@
+/**
+ * @file dtn-bench.h
+ * @author Archie Norman
+ * @brief Microbenchmarks for the protocol hot paths. A bench build replaces the
+ * button process with a process that fills the cache and times broadcast_recv,
+ * recv_runicast, sent_runicast and the summary vector loop. Cache and summary
+ * sizes are fixed at compile time, bench.sh rebuilds for each size in the sweep.
+ *
+ * Every result is one line, fields are always in the same order:
+ *
+ *   [BENCH] <path> msgs <MAX_MESSAGES> vec <MAX_MSG_VECTORS> iters <n> <unit> <per op> allocs <per op>
+ *
+ * The unit is ns_op on the native target (clock_gettime) and rt_op elsewhere,
+ * in rtimer ticks at RTIMER_SECOND which is printed in the [BENCH-CONF] line.
+ */
+#ifndef __DTN_BENCH_H__
+#define __DTN_BENCH_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_BENCH
+#define DTN_BENCH DTN_CONF_BENCH
+#else
+#define DTN_BENCH 0
+#endif
+///Number of timed calls for each path
+#ifdef DTN_CONF_BENCH_ITERATIONS
+#define DTN_BENCH_ITERATIONS DTN_CONF_BENCH_ITERATIONS
+#else
+#define DTN_BENCH_ITERATIONS 1000
+#endif
+///The protocol entry points under test, handed over by dtn.c
+struct dtn_bench_hooks
+{
+	struct broadcast_conn *bc;
+	const struct broadcast_callbacks *bc_call;
+	struct runicast_conn *uc;
+	const struct runicast_callbacks *uc_call;
+	int (* build_summary)(dtn_summary_vector *send);
+	///Counter dtn.c increments on every cache allocation
+	int *allocs;
+};
+/*
+ * @brief Start the benchmark process
+ * @param1 - the protocol entry points to time
+ */
+void dtn_bench_start(const struct dtn_bench_hooks *hooks);
+
+#endif /* __DTN_BENCH_H__ */
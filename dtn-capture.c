@@ -0,0 +1,144 @@
+/**
+ * @file dtn-capture.c
+ * @author Archie Norman
+ * @brief Frame capture for offline replay, the format is described in dtn-capture.h.
+ * The serial backend prints each record as a "[CAP] " line of hex so it can be
+ * grepped out of the console log like the other tagged records, capture.sh turns
+ * those lines back in to a binary capture file.
+ */
+#include "dtn-capture.h"
+#include "lib/random.h"
+#include "cfs/cfs.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_CAPTURE
+///Time the capture was started, records are stored relative to it
+static clock_time_t capture_start;
+///Scratch buffer the record is serialised in to before it is written out
+static uint8_t record[DTN_CAPTURE_RECORD_LEN + PACKETBUF_SIZE];
+/*
+ * @brief Serialise an integer little endian
+ * @param1 - where to write
+ * @param2 - the value
+ * @param3 - the number of bytes to write
+ */
+static uint8_t *
+put_le(uint8_t *p, uint32_t value, uint8_t bytes)
+{
+  while(bytes-- > 0) {
+    *p++ = value & 0xff;
+    value >>= 8;
+  }
+  return p;
+}
+/*
+ * @brief Write out a serialised block to the selected backend
+ * @param1 - the data
+ * @param2 - the length
+ * @param3 - non zero to start a new capture rather than append
+ */
+static void
+capture_write(const uint8_t *data, int len, int truncate)
+{
+#if DTN_CAPTURE == DTN_CAPTURE_CFS
+  int fd;
+  ///Open and close around every record so a reset loses at most one frame
+  fd = cfs_open(DTN_CAPTURE_FILE, truncate ? CFS_WRITE : CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    printf("--- [ALERT] Could not open capture file %s\n", DTN_CAPTURE_FILE);
+    return;
+  }
+  cfs_write(fd, data, len);
+  cfs_close(fd);
+#else
+  int i;
+  printf("[CAP] ");
+  for(i = 0; i < len; i++) {
+    printf("%02x", data[i]);
+  }
+  printf("\n");
+#endif
+}
+/*
+ * @brief Serialise the header of a record
+ * @param1 - the kind
+ * @param2 - the address
+ * @param3 - the value
+ * @param4 - the payload length that follows
+ * @return where the payload goes
+ */
+static uint8_t *
+put_record(uint8_t kind, const rimeaddr_t *addr, uint8_t value, uint16_t len)
+{
+  uint8_t *p;
+
+  p = put_le(record, clock_time() - capture_start, 4);
+  *p++ = kind;
+  memcpy(p, addr, RIMEADDR_SIZE);
+  p += RIMEADDR_SIZE;
+  *p++ = value;
+  return put_le(p, len, 2);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_capture_init(const rimeaddr_t *node_addr)
+{
+  uint16_t seed;
+  uint8_t *p;
+  ///Pick a seed and restart the generator with it so the replay can use the same one
+  seed = random_rand() ^ (uint16_t)clock_time();
+  random_init(seed);
+  capture_start = clock_time();
+
+  p = record;
+  memcpy(p, DTN_CAPTURE_MAGIC, 4);
+  p += 4;
+  *p++ = DTN_CAPTURE_VERSION;
+  memcpy(p, node_addr, RIMEADDR_SIZE);
+  p += RIMEADDR_SIZE;
+  p = put_le(p, seed, 2);
+  p = put_le(p, CLOCK_SECOND, 2);
+  capture_write(record, p - record, 1);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_capture_frame(uint8_t kind, const rimeaddr_t *from, uint8_t seqno)
+{
+  uint8_t *p;
+  uint16_t len;
+
+  len = packetbuf_datalen();
+  if(len > PACKETBUF_SIZE) {
+    len = PACKETBUF_SIZE;
+  }
+  p = put_record(kind, from, seqno, len);
+  memcpy(p, packetbuf_dataptr(), len);
+  p += len;
+  capture_write(record, p - record, 0);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_capture_send(const rimeaddr_t *dest, const void *payload, uint8_t len, uint8_t copies, uint8_t priority)
+{
+  uint8_t *p;
+
+  if(len >= PACKETBUF_SIZE) {
+    len = PACKETBUF_SIZE - 1;
+  }
+  p = put_record(DTN_CAPTURE_SEND, dest, copies, len + 1);
+  *p++ = priority;
+  memcpy(p, payload, len);
+  p += len;
+  capture_write(record, p - record, 0);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_capture_outcome(uint8_t kind, const rimeaddr_t *to, uint8_t retransmissions)
+{
+  uint8_t *p;
+
+  p = put_record(kind, to, retransmissions, 0);
+  capture_write(record, p - record, 0);
+}
+#endif /* DTN_CAPTURE */
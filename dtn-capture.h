@@ -0,0 +1,92 @@
+/**
+ * @file dtn-capture.h
+ * @author Archie Norman
+ * @brief Records every frame handed to the DTN receive callbacks, the bundles
+ * created here and the outcome of every runicast, so a field run can be
+ * replayed offline (see dtn-replay.h). Capture is disabled unless
+ * DTN_CONF_CAPTURE is set in project-conf.h.
+ *
+ * The capture is a compact binary stream, all fields little endian:
+ *
+ *   file header:  'D' 'T' 'N' 'C' | version | node address | seed (2) | CLOCK_SECOND (2)
+ *   record:       time (4) | kind | address | value | len (2) | len bytes of payload
+ *
+ * time is clock_time() relative to dtn_capture_init(), seed is the value
+ * passed to random_init() when capture started. What address, value and
+ * payload hold depends on the kind:
+ *
+ *   broadcast, runicast: the sender | the runicast seqno, 0 for broadcasts | the frame
+ *   send:                the destination | copies | priority and the bundle payload
+ *   sent, timed out:     the neighbour | retransmissions | nothing
+ *
+ * Only the core path is recorded. The custody, coding, multicast and
+ * frequency channels and the overhearing sniffer are not, so a capture
+ * from a node running those modules does not replay the same.
+ */
+#ifndef __DTN_CAPTURE_H__
+#define __DTN_CAPTURE_H__
+#include "contiki.h"
+#include "net/rime.h"
+#include <stdint.h>
+///Capture backends, selected with DTN_CONF_CAPTURE
+#define DTN_CAPTURE_NONE   0
+#define DTN_CAPTURE_SERIAL 1
+#define DTN_CAPTURE_CFS    2
+
+#ifdef DTN_CONF_CAPTURE
+#define DTN_CAPTURE DTN_CONF_CAPTURE
+#else
+#define DTN_CAPTURE DTN_CAPTURE_NONE
+#endif
+///Name of the capture file when writing to CFS, also read by the replayer
+#ifdef DTN_CONF_CAPTURE_FILE
+#define DTN_CAPTURE_FILE DTN_CONF_CAPTURE_FILE
+#else
+#define DTN_CAPTURE_FILE "dtn.cap"
+#endif
+
+#define DTN_CAPTURE_MAGIC   "DTNC"
+///Bumped whenever the records change layout, 3 since len is two bytes and sends and runicast outcomes are recorded
+#define DTN_CAPTURE_VERSION 3
+///Size of the file header and of a record header on the wire
+#define DTN_CAPTURE_HDR_LEN    (4 + 1 + RIMEADDR_SIZE + 2 + 2)
+#define DTN_CAPTURE_RECORD_LEN (4 + 1 + RIMEADDR_SIZE + 1 + 2)
+///Which callback the record is replayed through
+enum
+{
+	DTN_CAPTURE_BROADCAST = 1,
+	DTN_CAPTURE_RUNICAST = 2,
+	DTN_CAPTURE_SEND = 3,
+	DTN_CAPTURE_SENT = 4,
+	DTN_CAPTURE_TIMEDOUT = 5
+};
+/*
+ * @brief Seeds the random generator with a fresh seed and writes the file header
+ * @param1 - the node address recorded in the header
+ */
+void dtn_capture_init(const rimeaddr_t *node_addr);
+/*
+ * @brief Appends the frame currently in the packet buffer to the capture
+ * @param1 - DTN_CAPTURE_BROADCAST or DTN_CAPTURE_RUNICAST
+ * @param2 - the sender passed to the receive callback
+ * @param3 - the runicast sequence number, 0 for broadcasts
+ */
+void dtn_capture_frame(uint8_t kind, const rimeaddr_t *from, uint8_t seqno);
+/*
+ * @brief Appends a bundle created with dtn_send() to the capture
+ * @param1 - the destination
+ * @param2 - the payload
+ * @param3 - the payload length
+ * @param4 - the copies asked for
+ * @param5 - the priority
+ */
+void dtn_capture_send(const rimeaddr_t *dest, const void *payload, uint8_t len, uint8_t copies, uint8_t priority);
+/*
+ * @brief Appends the outcome of a runicast to the capture
+ * @param1 - DTN_CAPTURE_SENT or DTN_CAPTURE_TIMEDOUT
+ * @param2 - the neighbour
+ * @param3 - the retransmissions passed to the callback
+ */
+void dtn_capture_outcome(uint8_t kind, const rimeaddr_t *to, uint8_t retransmissions);
+
+#endif /* __DTN_CAPTURE_H__ */
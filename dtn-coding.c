@@ -0,0 +1,296 @@
+/**
+ * @file dtn-coding.c
+ * @author Archie Norman
+ * @brief Pairs up bundles two neighbours are missing from each other and
+ * sends them xored in one broadcast.
+ */
+#include "dtn-coding.h"
+#include "dtn-group.h"
+#include "dtn-plan.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_CODING
+static struct broadcast_conn coded_conn;
+static struct unicast_conn ack_conn;
+static list_t messages;
+static const struct dtn_coding_hooks *coding_hooks;
+///The last summary vector heard from each neighbour
+static struct {
+  rimeaddr_t addr;
+  uint8_t len;
+  dtn_msg_id ids[MAX_MSG_VECTORS];
+  struct timer age;
+} neighbours[DTN_CODING_NEIGHBOURS];
+static uint8_t next_slot;
+///The coded frame waiting for its acks
+static dtn_coded_frame pending;
+static uint8_t pending_acks;
+static struct timer pending_timer;
+///Acks go between sky and OrisenPrime nodes, both have to agree on the layout
+DTN_STATIC_ASSERT(sizeof(dtn_coded_ack) == 1 + DTN_MSG_ID_SIZE, coded_ack_packed);
+/*
+ * @brief Compare two message ids
+ */
+static int
+msg_id_cmp(const dtn_msg_id *a, const dtn_msg_id *b)
+{
+  return rimeaddr_cmp(&a->src, &b->src) && rimeaddr_cmp(&a->dest, &b->dest) && a->seq == b->seq;
+}
+/*
+ * @brief Checks if a neighbour advertised a message id
+ * @param1 - the neighbour's slot
+ * @param2 - the message id
+ */
+static int
+holds(int n, const dtn_msg_id *id)
+{
+  int i;
+  for(i = 0; i < neighbours[n].len; i++) {
+    if(msg_id_cmp(&neighbours[n].ids[i], id)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*
+ * @brief The slot of a neighbour whose summary is still fresh, -1 if none
+ */
+static int
+find_neighbour(const rimeaddr_t *addr)
+{
+  int n;
+  for(n = 0; n < DTN_CODING_NEIGHBOURS; n++) {
+    if(rimeaddr_cmp(&neighbours[n].addr, addr) && !timer_expired(&neighbours[n].age)) {
+      return n;
+    }
+  }
+  return -1;
+}
+/*
+ * @brief Find a bundle in the cache
+ */
+static dtn_message *
+find_message(const dtn_msg_id *id)
+{
+  dtn_vector_list *tmp;
+  for(tmp = list_head(messages); tmp != NULL; tmp = list_item_next(tmp)) {
+    if(msg_id_cmp(&tmp->message.hdr.message_id, id)) {
+      return &tmp->message;
+    }
+  }
+  return NULL;
+}
+/*
+ * @brief Whether a bundle can go in a coded frame. Group bundles split
+ * their copies per member and planned bundles go whole to one next hop,
+ * the coded frame ack only does the plain spray bookkeeping
+ */
+static int
+codable(const dtn_message *message)
+{
+#if DTN_PLAN
+  rimeaddr_t hop;
+  if(dtn_plan_next_hop(&message->hdr.message_id.dest, &hop)) {
+    return 0;
+  }
+#endif
+#if DTN_GROUPS
+  if(dtn_group_is_group(&message->hdr.message_id.dest)) {
+    return 0;
+  }
+#endif
+  return 1;
+}
+/*
+ * @brief Xor the coded part of a bundle in to a frame
+ */
+static void
+xor_message(dtn_coded_frame *frame, const dtn_message *message)
+{
+  int i;
+  frame->timestamp ^= message->hdr.timestamp;
+  frame->length ^= message->hdr.length;
+  frame->priority ^= message->hdr.priority;
+  for(i = 0; i < MAX_MSG_SIZE; i++) {
+    frame->msg[i] ^= message->msg[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_ack(const rimeaddr_t *to, const dtn_msg_id *id, uint8_t decoded)
+{
+  dtn_coded_ack ack;
+  ack.decoded = decoded;
+  ack.id = *id;
+  packetbuf_copyfrom(&ack, sizeof(dtn_coded_ack));
+  unicast_send(&ack_conn, to);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_coded(struct broadcast_conn *c, const rimeaddr_t *from)
+{
+  dtn_coded_frame frame;
+  dtn_message decoded;
+  const dtn_message *other;
+  int i, k;
+
+  if(packetbuf_datalen() < sizeof(dtn_coded_frame)) {
+    return;
+  }
+  memcpy(&frame, packetbuf_dataptr(), sizeof(dtn_coded_frame));
+  for(k = 0; k < 2; k++) {
+    if(!rimeaddr_cmp(&frame.to[k], &rimeaddr_node_addr)) {
+      continue;
+    }
+    other = find_message(&frame.id[1 - k]);
+    if(other == NULL) {
+      PRINTF("--- [CODE] Cannot decode from %d.%d, no longer holding the other bundle\n", from->u8[0], from->u8[1]);
+      send_ack(from, &frame.id[k], 0);
+      return;
+    }
+    memset(&decoded, 0, sizeof(dtn_message));
+    decoded.hdr.message_id = frame.id[k];
+    decoded.hdr.number_of_copies = frame.number_of_copies[k];
+    decoded.hdr.timestamp = frame.timestamp ^ other->hdr.timestamp;
+    decoded.hdr.length = frame.length ^ other->hdr.length;
+    decoded.hdr.priority = frame.priority ^ other->hdr.priority;
+    for(i = 0; i < MAX_MSG_SIZE; i++) {
+      decoded.msg[i] = frame.msg[i] ^ other->msg[i];
+    }
+    PRINTF("--- [CODE] Decoded a bundle from %d.%d\n", from->u8[0], from->u8[1]);
+    coding_hooks->received(&decoded, from);
+    send_ack(from, &decoded.hdr.message_id, 1);
+    return;
+  }
+}
+static const struct broadcast_callbacks coded_callbacks = {recv_coded, NULL};
+/*---------------------------------------------------------------------------*/
+static void
+recv_ack(struct unicast_conn *c, const rimeaddr_t *from)
+{
+  dtn_coded_ack ack;
+  int k, n;
+
+  if(packetbuf_datalen() < sizeof(dtn_coded_ack)) {
+    return;
+  }
+  memcpy(&ack, packetbuf_dataptr(), sizeof(dtn_coded_ack));
+  for(k = 0; k < 2; k++) {
+    if((pending_acks & (1 << k)) && rimeaddr_cmp(&pending.to[k], from) && msg_id_cmp(&pending.id[k], &ack.id)) {
+      pending_acks &= ~(1 << k);
+      if(ack.decoded) {
+        coding_hooks->sent(&ack.id, from);
+      }
+      else {
+        ///Its summary is out of date, do not code for it again until it beacons
+        n = find_neighbour(from);
+        if(n >= 0) {
+          timer_set(&neighbours[n].age, 0);
+        }
+      }
+      return;
+    }
+  }
+}
+static const struct unicast_callbacks ack_callbacks = {recv_ack, NULL};
+/*---------------------------------------------------------------------------*/
+void
+dtn_coding_open(list_t cache, const struct dtn_coding_hooks *hooks)
+{
+  messages = cache;
+  coding_hooks = hooks;
+  broadcast_open(&coded_conn, DTN_CODING_CHANNEL, &coded_callbacks);
+  unicast_open(&ack_conn, DTN_CODING_CHANNEL + 1, &ack_callbacks);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_coding_beacon(const rimeaddr_t *from, const dtn_summary_vector *beacon)
+{
+  int n;
+  for(n = 0; n < DTN_CODING_NEIGHBOURS; n++) {
+    if(rimeaddr_cmp(&neighbours[n].addr, from)) {
+      break;
+    }
+  }
+  if(n == DTN_CODING_NEIGHBOURS) {
+    n = next_slot;
+    next_slot = (next_slot + 1) % DTN_CODING_NEIGHBOURS;
+    rimeaddr_copy(&neighbours[n].addr, from);
+  }
+  neighbours[n].len = beacon->header.len < MAX_MSG_VECTORS ? beacon->header.len : MAX_MSG_VECTORS;
+  memcpy(neighbours[n].ids, beacon->message_ids, neighbours[n].len * sizeof(dtn_msg_id));
+  timer_set(&neighbours[n].age, DTN_CODING_MAX_AGE);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_coding_heard(const rimeaddr_t *to, const dtn_msg_id *id)
+{
+  int n;
+  n = find_neighbour(to);
+  if(n < 0 || holds(n, id) || neighbours[n].len >= MAX_MSG_VECTORS) {
+    return;
+  }
+  neighbours[n].ids[neighbours[n].len++] = *id;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_coding_pair(const rimeaddr_t *to, dtn_message *candidates, int len)
+{
+  dtn_vector_list *tmp;
+  dtn_message y;
+  int b, a, x;
+
+  ///One coded frame at a time
+  if(pending_acks && !timer_expired(&pending_timer)) {
+    return len;
+  }
+  b = find_neighbour(to);
+  if(b < 0) {
+    return len;
+  }
+  for(a = 0; a < DTN_CODING_NEIGHBOURS; a++) {
+    if(a == b || timer_expired(&neighbours[a].age)) {
+      continue;
+    }
+    ///X: missing at B and held by A
+    for(x = 0; x < len; x++) {
+      if(!codable(&candidates[x]) || !holds(a, &candidates[x].hdr.message_id)) {
+        continue;
+      }
+      ///Y: held by B, missing at A and something we would spray to A
+      for(tmp = list_head(messages); tmp != NULL; tmp = list_item_next(tmp)) {
+        if(!codable(&tmp->message)) {
+          continue;
+        }
+        if(holds(b, &tmp->message.hdr.message_id) && !holds(a, &tmp->message.hdr.message_id) &&
+           coding_hooks->spray(&tmp->message, &neighbours[a].addr, &y)) {
+          break;
+        }
+      }
+      if(tmp == NULL) {
+        continue;
+      }
+      memset(&pending, 0, sizeof(dtn_coded_frame));
+      pending.id[0] = candidates[x].hdr.message_id;
+      pending.to[0] = *to;
+      pending.number_of_copies[0] = candidates[x].hdr.number_of_copies;
+      pending.id[1] = y.hdr.message_id;
+      pending.to[1] = neighbours[a].addr;
+      pending.number_of_copies[1] = y.hdr.number_of_copies;
+      xor_message(&pending, &candidates[x]);
+      xor_message(&pending, &y);
+      packetbuf_copyfrom(&pending, sizeof(dtn_coded_frame));
+      broadcast_send(&coded_conn);
+      pending_acks = 3;
+      timer_set(&pending_timer, DTN_CODING_ACK_TIME);
+      PRINTF("--- [CODE] Coded frame for %d.%d and %d.%d\n",
+        to->u8[0], to->u8[1], neighbours[a].addr.u8[0], neighbours[a].addr.u8[1]);
+      ///X went in the coded frame, the rest still go by runicast
+      memmove(&candidates[x], &candidates[x + 1], (len - x - 1) * sizeof(dtn_message));
+      return len - 1;
+    }
+  }
+  return len;
+}
+#endif /* DTN_CODING */
@@ -0,0 +1,111 @@
+/**
+ * @file dtn-coding.h
+ * @author Archie Norman
+ * @brief Opportunistic XOR coding. The last summary vector heard from each
+ * neighbour is kept, so when a beacon from B shows it is missing bundle X
+ * we look for a neighbour A that holds X and is itself missing a bundle Y
+ * that B holds. X and Y then go out as one broadcast frame carrying
+ * X xor Y, A decodes Y with its copy of X and B decodes X with its copy of
+ * Y. Each receiver answers with a small unicast ack, only then does the
+ * sender account for the copies it handed over. A receiver that no longer
+ * holds the bundle it needs to decode answers with a nack; nothing is lost
+ * either way, the neighbour still advertises the bundle as missing and gets
+ * it by runicast in answer to its next beacon. Enable with DTN_CONF_CODING
+ * in project-conf.h.
+ */
+#ifndef __DTN_CODING_H__
+#define __DTN_CODING_H__
+#include "dtn.h"
+#include "lib/list.h"
+
+#ifdef DTN_CONF_CODING
+#define DTN_CODING DTN_CONF_CODING
+#else
+#define DTN_CODING 0
+#endif
+///Neighbour summaries kept for finding coding pairs
+#ifdef DTN_CODING_CONF_NEIGHBOURS
+#define DTN_CODING_NEIGHBOURS DTN_CODING_CONF_NEIGHBOURS
+#else
+#define DTN_CODING_NEIGHBOURS 4
+#endif
+///How long a neighbour summary is trusted, a couple of beacon periods
+#ifdef DTN_CODING_CONF_MAX_AGE
+#define DTN_CODING_MAX_AGE DTN_CODING_CONF_MAX_AGE
+#else
+#define DTN_CODING_MAX_AGE (CLOCK_SECOND * 10)
+#endif
+///How long a coded frame waits for its acks
+#ifdef DTN_CODING_CONF_ACK_TIME
+#define DTN_CODING_ACK_TIME DTN_CODING_CONF_ACK_TIME
+#else
+#define DTN_CODING_ACK_TIME (CLOCK_SECOND * 2)
+#endif
+///Broadcast channel for coded frames, the acks use the next channel up
+#ifdef DTN_CODING_CONF_CHANNEL
+#define DTN_CODING_CHANNEL DTN_CODING_CONF_CHANNEL
+#else
+#define DTN_CODING_CHANNEL 247
+#endif
+
+/*
+ *Two bundles in one frame. The ids, destinations and copy counts go in the
+ *clear, everything else a receiver already has for the other bundle is
+ *xored together.
+ */
+typedef struct
+{
+	dtn_msg_id id[2];
+	rimeaddr_t to[2];
+	uint8_t number_of_copies[2];
+	uint32_t timestamp;
+	uint8_t length;
+	uint8_t priority;
+	char msg[MAX_MSG_SIZE];
+}DTN_PACKED dtn_coded_frame;
+///Answer to a coded frame
+typedef struct
+{
+	uint8_t decoded;
+	dtn_msg_id id;
+}DTN_PACKED dtn_coded_ack;
+///The cache side of coding, provided by dtn.c
+struct dtn_coding_hooks
+{
+	///Fills in the copy of a bundle that would be sprayed to a neighbour, 0 if it would not be
+	int (* spray)(const dtn_message *message, const rimeaddr_t *to, dtn_message *out);
+	///A neighbour acknowledged a bundle from a coded frame
+	void (* sent)(const dtn_msg_id *id, const rimeaddr_t *to);
+	///We decoded a bundle meant for us
+	void (* received)(const dtn_message *message, const rimeaddr_t *from);
+};
+/*
+ * @brief Open the coding channels
+ * @param1 - the message cache
+ * @param2 - the cache hooks
+ */
+void dtn_coding_open(list_t cache, const struct dtn_coding_hooks *hooks);
+/*
+ * @brief Remember a neighbour's summary vector
+ * @param1 - the neighbour
+ * @param2 - its summary vector
+ */
+void dtn_coding_beacon(const rimeaddr_t *from, const dtn_summary_vector *beacon);
+/*
+ * @brief A bundle was overheard going to a neighbour, count it as held until
+ * the neighbour's next summary vector
+ * @param1 - the neighbour
+ * @param2 - the message id
+ */
+void dtn_coding_heard(const rimeaddr_t *to, const dtn_msg_id *id);
+/*
+ * @brief Look for a bundle picked for a neighbour that can be coded with
+ * one another neighbour is missing, sends the coded frame if there is one
+ * @param1 - the neighbour
+ * @param2 - the bundles picked for it
+ * @param3 - how many were picked
+ * @return how many are left to send by runicast
+ */
+int dtn_coding_pair(const rimeaddr_t *to, dtn_message *messages, int len);
+
+#endif /* __DTN_CODING_H__ */
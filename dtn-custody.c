@@ -0,0 +1,218 @@
+/**
+ * @file dtn-custody.c
+ * @author Archie Norman
+ * @brief Custody offers and signals on their own runicast channel, so an
+ * offload does not have to wait for the spray traffic.
+ */
+#include "dtn-custody.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_CUSTODY
+#define MAX_RETRANSMISSIONS 4
+static struct runicast_conn custody_conn;
+static const struct dtn_custody_hooks *custody_hooks;
+///The last custodian heard, and until when it is left alone after a refusal
+static rimeaddr_t custodian;
+static struct timer custodian_backoff;
+///The offer waiting for its signal
+static uint8_t pending;
+static dtn_msg_id pending_id;
+static rimeaddr_t pending_to;
+static struct timer pending_timer;
+///A custody signal and who it goes to
+struct custody_signal
+{
+  dtn_custody_frame frame;
+  rimeaddr_t to;
+};
+///What the channel is sending, the bundle of an accepting signal is only taken once it is acknowledged
+static uint8_t on_air;
+static struct custody_signal signal;
+///A signal waiting for the channel to come free
+static uint8_t queued;
+static struct custody_signal queued_signal;
+/*
+ * @brief Compare two message ids
+ */
+static int
+msg_id_cmp(const dtn_msg_id *a, const dtn_msg_id *b)
+{
+  return rimeaddr_cmp(&a->src, &b->src) && rimeaddr_cmp(&a->dest, &b->dest) && a->seq == b->seq;
+}
+/*
+ * @brief Put the signal on the air
+ */
+static void
+transmit_signal(void)
+{
+  packetbuf_copyfrom(&signal.frame, sizeof(dtn_custody_frame));
+  runicast_send(&custody_conn, &signal.to, MAX_RETRANSMISSIONS);
+  on_air = DTN_CUSTODY_SIGNAL;
+}
+/*
+ * @brief Answer an offer, or queue the answer while the channel is busy
+ * @param1 - the neighbour that made the offer
+ * @param2 - the offered bundle
+ * @param3 - the reason code
+ */
+static void
+send_signal(const rimeaddr_t *to, const dtn_message *message, uint8_t reason)
+{
+  struct custody_signal *s;
+  if(runicast_is_transmitting(&custody_conn)) {
+    if(queued) {
+      ///Nothing was taken, the offer times out and the sender keeps the bundle
+      if(reason == DTN_CUSTODY_ACCEPTED) {
+        custody_hooks->cancel();
+      }
+      return;
+    }
+    s = &queued_signal;
+    queued = 1;
+  }
+  else {
+    s = &signal;
+  }
+  s->frame.kind = DTN_CUSTODY_SIGNAL;
+  s->frame.reason = reason;
+  memcpy(&s->frame.message, message, sizeof(dtn_message));
+  rimeaddr_copy(&s->to, to);
+  if(s == &signal) {
+    transmit_signal();
+  }
+}
+/*
+ * @brief The last send finished either way, a queued signal goes next
+ */
+static void
+channel_free(void)
+{
+  on_air = 0;
+  if(queued) {
+    queued = 0;
+    memcpy(&signal, &queued_signal, sizeof(struct custody_signal));
+    transmit_signal();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_custody(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno)
+{
+  dtn_custody_frame frame;
+  uint8_t reason;
+
+  if(packetbuf_datalen() < sizeof(dtn_custody_frame)) {
+    return;
+  }
+  memcpy(&frame, packetbuf_dataptr(), sizeof(dtn_custody_frame));
+  if(frame.kind == DTN_CUSTODY_OFFER) {
+#if DTN_CUSTODY_CUSTODIAN
+    reason = custody_hooks->check(&frame.message);
+#else
+    reason = DTN_CUSTODY_REFUSED_NOT_CUSTODIAN;
+#endif
+    PRINTF("--- [CUSTODY] Offer from %d.%d, reason %d\n", from->u8[0], from->u8[1], reason);
+    send_signal(from, &frame.message, reason);
+  }
+  else if(frame.kind == DTN_CUSTODY_SIGNAL) {
+    if(!pending || !rimeaddr_cmp(from, &pending_to) || !msg_id_cmp(&frame.message.hdr.message_id, &pending_id)) {
+      return;
+    }
+    pending = 0;
+    if(frame.reason == DTN_CUSTODY_ACCEPTED) {
+      PRINTF("--- [CUSTODY] %d.%d accepted custody, freeing our copy\n", from->u8[0], from->u8[1]);
+      custody_hooks->release(&frame.message.hdr.message_id);
+    }
+    else {
+      PRINTF("--- [CUSTODY] %d.%d refused custody, reason %d\n", from->u8[0], from->u8[1], frame.reason);
+      timer_set(&custodian_backoff, DTN_CUSTODY_BACKOFF);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sent_custody(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions)
+{
+  ///The neighbour has our acceptance and frees its copy, now the bundle is ours
+  if(on_air == DTN_CUSTODY_SIGNAL && signal.frame.reason == DTN_CUSTODY_ACCEPTED) {
+    PRINTF("--- [CUSTODY] %d.%d has our signal, taking custody\n", to->u8[0], to->u8[1]);
+    custody_hooks->accept(&signal.frame.message, to);
+  }
+  channel_free();
+}
+/*---------------------------------------------------------------------------*/
+static void
+timedout_custody(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions)
+{
+  ///The offer never arrived, we still hold the bundle
+  if(on_air == DTN_CUSTODY_OFFER && pending && rimeaddr_cmp(to, &pending_to)) {
+    pending = 0;
+  }
+  ///The neighbour never heard our acceptance and keeps the bundle, so we do not take it
+  else if(on_air == DTN_CUSTODY_SIGNAL) {
+    PRINTF("--- [CUSTODY] Signal to %d.%d timed out\n", to->u8[0], to->u8[1]);
+    if(signal.frame.reason == DTN_CUSTODY_ACCEPTED) {
+      custody_hooks->cancel();
+    }
+  }
+  channel_free();
+}
+static const struct runicast_callbacks custody_callbacks = {recv_custody, sent_custody, timedout_custody};
+/*---------------------------------------------------------------------------*/
+void
+dtn_custody_open(const struct dtn_custody_hooks *hooks)
+{
+  custody_hooks = hooks;
+  on_air = 0;
+  queued = 0;
+  rimeaddr_copy(&custodian, &rimeaddr_null);
+  timer_set(&custodian_backoff, 0);
+  runicast_open(&custody_conn, DTN_CUSTODY_CHANNEL, &custody_callbacks);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_custody_beacon(const rimeaddr_t *from, uint8_t flags)
+{
+  if(flags & DTN_FLAG_CUSTODIAN) {
+    if(!rimeaddr_cmp(from, &custodian)) {
+      timer_set(&custodian_backoff, 0);
+    }
+    rimeaddr_copy(&custodian, from);
+  }
+  else if(rimeaddr_cmp(from, &custodian)) {
+    rimeaddr_copy(&custodian, &rimeaddr_null);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_custody_offer(const dtn_message *message)
+{
+  dtn_custody_frame offer;
+
+  if(rimeaddr_cmp(&custodian, &rimeaddr_null) || !timer_expired(&custodian_backoff)) {
+    return 0;
+  }
+  if(pending && !timer_expired(&pending_timer)) {
+    return 0;
+  }
+  if(runicast_is_transmitting(&custody_conn)) {
+    return 0;
+  }
+  offer.kind = DTN_CUSTODY_OFFER;
+  offer.reason = DTN_CUSTODY_ACCEPTED;
+  memcpy(&offer.message, message, sizeof(dtn_message));
+  packetbuf_copyfrom(&offer, sizeof(dtn_custody_frame));
+  runicast_send(&custody_conn, &custodian, MAX_RETRANSMISSIONS);
+  on_air = DTN_CUSTODY_OFFER;
+
+  pending = 1;
+  pending_id = message->hdr.message_id;
+  rimeaddr_copy(&pending_to, &custodian);
+  timer_set(&pending_timer, DTN_CUSTODY_SIGNAL_TIMEOUT);
+  PRINTF("--- [CUSTODY] Offering <%d.%d:%d.%d:%d> to %d.%d\n",
+    pending_id.src.u8[0], pending_id.src.u8[1], pending_id.dest.u8[0], pending_id.dest.u8[1],
+    pending_id.seq, custodian.u8[0], custodian.u8[1]);
+  return 1;
+}
+#endif /* DTN_CUSTODY */
@@ -0,0 +1,108 @@
+/**
+ * @file dtn-custody.h
+ * @author Archie Norman
+ * @brief Custody transfer. A node whose cache is close to full offers its
+ * oldest bundle to a neighbour that advertises DTN_FLAG_CUSTODIAN in its
+ * beacons. The neighbour answers with a custody signal, only when it accepts
+ * custody does the sender free its copy, a refusal carries a reason code and
+ * the sender keeps the bundle. The neighbour only takes the bundle in once
+ * its acceptance is acknowledged, so a signal that never arrives does not
+ * leave the bundle with both. Enable with DTN_CONF_CUSTODY, nodes that should
+ * take custody (e.g. SD card backed nodes with large caches) also set
+ * DTN_CUSTODY_CONF_CUSTODIAN.
+ */
+#ifndef __DTN_CUSTODY_H__
+#define __DTN_CUSTODY_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_CUSTODY
+#define DTN_CUSTODY DTN_CONF_CUSTODY
+#else
+#define DTN_CUSTODY 0
+#endif
+///Whether this node accepts custody from its neighbours
+#ifdef DTN_CUSTODY_CONF_CUSTODIAN
+#define DTN_CUSTODY_CUSTODIAN DTN_CUSTODY_CONF_CUSTODIAN
+#else
+#define DTN_CUSTODY_CUSTODIAN 0
+#endif
+///Free cache slots we try to keep by offloading to a custodian
+#ifdef DTN_CUSTODY_CONF_HEADROOM
+#define DTN_CUSTODY_HEADROOM DTN_CUSTODY_CONF_HEADROOM
+#else
+#define DTN_CUSTODY_HEADROOM 1
+#endif
+///Rime channel used for custody offers and signals
+#ifdef DTN_CUSTODY_CONF_CHANNEL
+#define DTN_CUSTODY_CHANNEL DTN_CUSTODY_CONF_CHANNEL
+#else
+#define DTN_CUSTODY_CHANNEL 246
+#endif
+///How long an offer waits for its signal before another one can be made
+#ifdef DTN_CUSTODY_CONF_SIGNAL_TIMEOUT
+#define DTN_CUSTODY_SIGNAL_TIMEOUT DTN_CUSTODY_CONF_SIGNAL_TIMEOUT
+#else
+#define DTN_CUSTODY_SIGNAL_TIMEOUT (CLOCK_SECOND * 5)
+#endif
+///How long a refusing neighbour is left alone before it is asked again
+#ifdef DTN_CUSTODY_CONF_BACKOFF
+#define DTN_CUSTODY_BACKOFF DTN_CUSTODY_CONF_BACKOFF
+#else
+#define DTN_CUSTODY_BACKOFF (CLOCK_SECOND * 30)
+#endif
+
+///Custody frame kinds
+enum
+{
+	DTN_CUSTODY_OFFER = 1,
+	DTN_CUSTODY_SIGNAL = 2
+};
+///Custody signal reason codes, anything but ACCEPTED is a refusal
+enum
+{
+	DTN_CUSTODY_ACCEPTED = 0,
+	DTN_CUSTODY_REFUSED_NOT_CUSTODIAN = 1,
+	DTN_CUSTODY_REFUSED_NO_SPACE = 2
+};
+/*
+ *Sent on the custody channel. An offer carries the whole bundle,
+ *a signal carries the reason and the bundle header it refers to.
+ */
+typedef struct
+{
+	uint8_t kind;
+	uint8_t reason;
+	dtn_message message;
+}dtn_custody_frame;
+///The cache side of custody, provided by dtn.c
+struct dtn_custody_hooks
+{
+	///Whether we can take custody of an offered bundle, returns a reason code, room is kept if accepted
+	uint8_t (* check)(const dtn_message *message);
+	///The neighbour acknowledged our acceptance, take the bundle in
+	void (* accept)(const dtn_message *message, const rimeaddr_t *from);
+	///An acceptance was dropped or never acknowledged, give the room back
+	void (* cancel)(void);
+	///Custody was accepted by a neighbour, free our copy
+	void (* release)(const dtn_msg_id *id);
+};
+/*
+ * @brief Open the custody channel
+ * @param1 - the cache hooks
+ */
+void dtn_custody_open(const struct dtn_custody_hooks *hooks);
+/*
+ * @brief Note a beacon, so we know which neighbours are custodians
+ * @param1 - the neighbour
+ * @param2 - the flags from its summary vector
+ */
+void dtn_custody_beacon(const rimeaddr_t *from, uint8_t flags);
+/*
+ * @brief Offer a bundle to the last custodian heard, if there is one and no
+ * other offer is waiting for its signal
+ * @param1 - the bundle
+ * @return 1 if the offer was sent
+ */
+int dtn_custody_offer(const dtn_message *message);
+
+#endif /* __DTN_CUSTODY_H__ */
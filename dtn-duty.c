@@ -0,0 +1,244 @@
+/**
+ * @file dtn-duty.c
+ * @author Archie Norman
+ * @brief Wake windows, neighbour schedules and the process switching the radio.
+ */
+#include "dtn-duty.h"
+#include "net/netstack.h"
+#include "lib/random.h"
+#include <stdio.h>
+
+#if DTN_DUTY
+#define MS_TO_TICKS(ms) ((clock_time_t)((uint32_t)(ms) * CLOCK_SECOND / 1000))
+#define TICKS_TO_MS(t) ((uint16_t)((uint32_t)(t) * 1000 / CLOCK_SECOND))
+PROCESS(duty_process, "Duty cycle process");
+///Our own window starts at origin plus a whole number of periods
+static clock_time_t origin;
+///Set once we have a schedule, until then the radio stays on
+static uint8_t scheduled;
+static struct timer hold;
+static uint8_t radio_on;
+///Schedules of neighbours whose windows are not ours
+static struct
+{
+	rimeaddr_t addr;
+	clock_time_t origin;
+	struct timer heard;
+}schedules[DTN_DUTY_NEIGHBOURS];
+/*
+ * @brief Where we are in a schedule's period
+ */
+static clock_time_t
+into_period(clock_time_t now, clock_time_t from)
+{
+  if(now >= from) {
+    return (now - from) % DTN_DUTY_PERIOD;
+  }
+  return (DTN_DUTY_PERIOD - (from - now) % DTN_DUTY_PERIOD) % DTN_DUTY_PERIOD;
+}
+/*
+ * @brief Check if a schedule slot is in use, slots not heard from for a while are freed
+ */
+static int
+followed(int i)
+{
+  if(rimeaddr_cmp(&schedules[i].addr, &rimeaddr_null)) {
+    return 0;
+  }
+  if(timer_expired(&schedules[i].heard)) {
+    PRINTF("--- [DUTY] Lost %d.%d, no longer following its window\n",
+      schedules[i].addr.u8[0], schedules[i].addr.u8[1]);
+    rimeaddr_copy(&schedules[i].addr, &rimeaddr_null);
+    return 0;
+  }
+  return 1;
+}
+/*
+ * @brief Check a schedule's window and when it next opens or closes
+ * @param1 - the time now
+ * @param2 - the schedule's origin
+ * @param3 - set to the time left until the window opens or closes, if sooner
+ * @return 1 if the window is open
+ */
+static int
+in_window(clock_time_t now, clock_time_t from, clock_time_t *next)
+{
+  clock_time_t at = into_period(now, from), left;
+  int open = at < DTN_DUTY_WINDOW;
+  left = open ? DTN_DUTY_WINDOW - at : DTN_DUTY_PERIOD - at;
+  if(left < *next) {
+    *next = left;
+  }
+  return open;
+}
+/*
+ * @brief Whether the radio should be on now
+ * @param1 - set to the time left until that could change
+ */
+static int
+awake(clock_time_t *next)
+{
+  clock_time_t now = clock_time(), period;
+  int on = 0, i;
+
+  *next = DTN_DUTY_PERIOD;
+  if(!scheduled) {
+    return 1;
+  }
+  on |= in_window(now, origin, next);
+  ///One whole period in every DTN_DUTY_DISCOVERY is spent listening for other schedules
+  period = (clock_time_t)(now - origin) / DTN_DUTY_PERIOD;
+  if(DTN_DUTY_DISCOVERY > 1 && period % DTN_DUTY_DISCOVERY == DTN_DUTY_DISCOVERY - 1) {
+    on = 1;
+    if(DTN_DUTY_PERIOD - into_period(now, origin) < *next) {
+      *next = DTN_DUTY_PERIOD - into_period(now, origin);
+    }
+  }
+  for(i = 0; i < DTN_DUTY_NEIGHBOURS; i++) {
+    if(followed(i)) {
+      on |= in_window(now, schedules[i].origin, next);
+    }
+  }
+  if(!timer_expired(&hold)) {
+    on = 1;
+    if(timer_remaining(&hold) < *next) {
+      *next = timer_remaining(&hold);
+    }
+  }
+  if(*next == 0) {
+    *next = 1;
+  }
+  return on;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(duty_process, ev, data)
+{
+  static struct etimer et;
+  clock_time_t next;
+  int on;
+
+  PROCESS_BEGIN();
+  ///Listen for a whole period first, in case a neighbour's schedule can be taken on
+  NETSTACK_RADIO.on();
+  radio_on = 1;
+  etimer_set(&et, DTN_DUTY_PERIOD);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || (ev == PROCESS_EVENT_POLL && scheduled));
+  if(!scheduled) {
+    origin = clock_time();
+    scheduled = 1;
+    PRINTF("--- [DUTY] Nobody heard, starting our own schedule\n");
+  }
+  while(1) {
+    on = awake(&next);
+    if(on != radio_on) {
+      if(on) {
+        NETSTACK_RADIO.on();
+      }
+      else {
+        NETSTACK_RADIO.off();
+      }
+      radio_on = on;
+    }
+    etimer_set(&et, next);
+    ///Polled when a schedule or the hold changes
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || ev == PROCESS_EVENT_POLL);
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_duty_open(void)
+{
+  timer_set(&hold, 0);
+  process_start(&duty_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+dtn_duty_beacon_delay(void)
+{
+  clock_time_t now = clock_time(), next, left;
+  int i;
+
+  if(!scheduled) {
+    return DTN_DUTY_WINDOW + random_rand() % DTN_DUTY_PERIOD;
+  }
+  ///Whichever followed window opens first, a beacon already sent in this one waits for the next
+  next = DTN_DUTY_PERIOD - into_period(now, origin);
+  for(i = 0; i < DTN_DUTY_NEIGHBOURS; i++) {
+    if(followed(i)) {
+      left = DTN_DUTY_PERIOD - into_period(now, schedules[i].origin);
+      if(left < next) {
+        next = left;
+      }
+    }
+  }
+  ///Clear of the edges, the neighbour's clock may be a little off ours
+  return next + DTN_DUTY_WINDOW / 4 + random_rand() % (DTN_DUTY_WINDOW / 2 + 1);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+dtn_duty_phase(void)
+{
+  if(!scheduled) {
+    return DTN_DUTY_NO_PHASE;
+  }
+  return TICKS_TO_MS(into_period(clock_time(), origin));
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_duty_beacon(const rimeaddr_t *from, uint16_t phase)
+{
+  clock_time_t theirs = clock_time() - MS_TO_TICKS(phase), apart;
+  int i, free_slot = -1;
+
+  if(phase == DTN_DUTY_NO_PHASE) {
+    return;
+  }
+  if(!scheduled) {
+    ///Take on the first schedule we hear
+    origin = theirs;
+    scheduled = 1;
+    PRINTF("--- [DUTY] Following the schedule of %d.%d\n", from->u8[0], from->u8[1]);
+    process_poll(&duty_process);
+    return;
+  }
+  apart = into_period(theirs, origin);
+  if(apart > DTN_DUTY_PERIOD / 2) {
+    apart = DTN_DUTY_PERIOD - apart;
+  }
+  for(i = 0; i < DTN_DUTY_NEIGHBOURS; i++) {
+    if(rimeaddr_cmp(&schedules[i].addr, from)) {
+      break;
+    }
+    if(free_slot < 0 && !followed(i)) {
+      free_slot = i;
+    }
+  }
+  ///Windows that overlap ours need nothing extra
+  if(apart < DTN_DUTY_WINDOW / 2) {
+    if(i < DTN_DUTY_NEIGHBOURS) {
+      rimeaddr_copy(&schedules[i].addr, &rimeaddr_null);
+    }
+    return;
+  }
+  if(i == DTN_DUTY_NEIGHBOURS) {
+    if(free_slot < 0) {
+      return;
+    }
+    i = free_slot;
+    PRINTF("--- [DUTY] Following %d.%d's window as well, %d ms from ours\n",
+      from->u8[0], from->u8[1], TICKS_TO_MS(apart));
+  }
+  rimeaddr_copy(&schedules[i].addr, from);
+  schedules[i].origin = theirs;
+  timer_set(&schedules[i].heard, DTN_DUTY_PERIOD * DTN_DUTY_TIMEOUT_PERIODS);
+  process_poll(&duty_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_duty_hold(void)
+{
+  timer_set(&hold, DTN_DUTY_HOLD);
+  process_poll(&duty_process);
+}
+#endif /* DTN_DUTY */
@@ -0,0 +1,90 @@
+/**
+ * @file dtn-duty.h
+ * @author Archie Norman
+ * @brief Radio duty cycling driven by the DTN layer. The radio is only on for
+ * a DTN_DUTY_WINDOW wake window every DTN_DUTY_PERIOD and the summary vector
+ * is sent inside it, carrying how far in to its own window the sender is so
+ * neighbours learn its wake phase. As in S-MAC, a node listens for a whole
+ * period when it starts and takes on the schedule of the first neighbour it
+ * hears. Neighbours on other schedules are found by staying awake for one
+ * whole period every DTN_DUTY_LATENCY, after that their windows are followed
+ * as well and beaconed in. Bundle transfers hold the radio on for
+ * DTN_DUTY_HOLD.
+ *
+ * The radio is switched with NETSTACK_RADIO, so build with nullrdc
+ * (NETSTACK_CONF_RDC nullrdc_driver) and nothing else turns it on. Rime's
+ * announcements are sent on their own timers and can be missed, DTN_CONF_ANNOUNCE
+ * should be left off. Enable with DTN_CONF_DUTY in project-conf.h.
+ */
+#ifndef __DTN_DUTY_H__
+#define __DTN_DUTY_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_DUTY
+#define DTN_DUTY DTN_CONF_DUTY
+#else
+#define DTN_DUTY 0
+#endif
+///Time between wake windows, also the beacon period
+#ifdef DTN_DUTY_CONF_PERIOD
+#define DTN_DUTY_PERIOD DTN_DUTY_CONF_PERIOD
+#else
+#define DTN_DUTY_PERIOD (CLOCK_SECOND * 4)
+#endif
+///How long the radio is on in each period
+#ifdef DTN_DUTY_CONF_WINDOW
+#define DTN_DUTY_WINDOW DTN_DUTY_CONF_WINDOW
+#else
+#define DTN_DUTY_WINDOW (CLOCK_SECOND / 10)
+#endif
+///Longest a neighbour on another schedule goes unnoticed
+#ifdef DTN_DUTY_CONF_LATENCY
+#define DTN_DUTY_LATENCY DTN_DUTY_CONF_LATENCY
+#else
+#define DTN_DUTY_LATENCY (CLOCK_SECOND * 60)
+#endif
+///How long the radio stays on after a bundle transfer
+#ifdef DTN_DUTY_CONF_HOLD
+#define DTN_DUTY_HOLD DTN_DUTY_CONF_HOLD
+#else
+#define DTN_DUTY_HOLD CLOCK_SECOND
+#endif
+///Neighbour schedules followed besides our own
+#ifdef DTN_DUTY_CONF_NEIGHBOURS
+#define DTN_DUTY_NEIGHBOURS DTN_DUTY_CONF_NEIGHBOURS
+#else
+#define DTN_DUTY_NEIGHBOURS 4
+#endif
+///A neighbour's schedule is dropped after this many periods without a beacon
+#define DTN_DUTY_TIMEOUT_PERIODS 4
+///Sent as the phase while we are still listening for a schedule to take on
+#define DTN_DUTY_NO_PHASE 0xffff
+///Every this many periods one is spent listening throughout
+#define DTN_DUTY_DISCOVERY (DTN_DUTY_LATENCY / DTN_DUTY_PERIOD)
+
+/*
+ * @brief Start the duty cycle, the radio stays on for the first period
+ */
+void dtn_duty_open(void);
+/*
+ * @brief The delay before the next beacon, a random point inside the next
+ * wake window we follow
+ */
+clock_time_t dtn_duty_beacon_delay(void);
+/*
+ * @brief How far in to our own wake window we are, sent in beacons
+ * @return milliseconds since our window started, or DTN_DUTY_NO_PHASE
+ */
+uint16_t dtn_duty_phase(void);
+/*
+ * @brief Note a neighbour's wake phase from its beacon
+ * @param1 - the neighbour
+ * @param2 - the phase from its summary vector
+ */
+void dtn_duty_beacon(const rimeaddr_t *from, uint16_t phase);
+/*
+ * @brief Keep the radio on for DTN_DUTY_HOLD, called around bundle transfers
+ */
+void dtn_duty_hold(void);
+
+#endif /* __DTN_DUTY_H__ */
@@ -0,0 +1,195 @@
+/**
+ * @file dtn-freq.c
+ * @author Archie Norman
+ * @brief The request and answer exchange on the control frequency and the
+ * process timing each step of a transfer.
+ */
+#include "dtn-freq.h"
+#include "dtn-sim.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef CONTIKI_TARGET_SKY
+#include "dev/cc2420.h"
+#endif
+
+#if DTN_FREQ
+PROCESS(freq_process, "Frequency process");
+static struct unicast_conn freq_conn;
+static const struct dtn_freq_hooks *freq_hooks;
+static const uint8_t data_freqs[] = DTN_FREQ_DATA;
+///Where we are in a transfer
+enum
+{
+  FREQ_IDLE,
+  ///We asked a neighbour and wait for its answer
+  FREQ_ASKED,
+  ///It agreed, waiting out the guard before we retune
+  FREQ_AGREED,
+  ///Our runicast is on the data frequency
+  FREQ_SENDING,
+  ///We agreed, waiting out the guard before we retune
+  FREQ_ANSWERED,
+  ///Listening on the data frequency
+  FREQ_RECEIVING
+};
+static uint8_t state;
+static uint8_t freq;
+static rimeaddr_t peer;
+/*
+ * @brief Send a request or an answer on the control frequency
+ */
+static void
+send_frame(uint8_t type, const rimeaddr_t *to)
+{
+  dtn_freq_frame frame;
+  frame.type = type;
+  frame.freq = freq;
+  packetbuf_copyfrom(&frame, sizeof(dtn_freq_frame));
+  unicast_send(&freq_conn, to);
+}
+/*---------------------------------------------------------------------------*/
+static void
+back_to_control(void)
+{
+  if(state == FREQ_SENDING || state == FREQ_RECEIVING) {
+    DTN_FREQ_SET(DTN_FREQ_CONTROL);
+  }
+  state = FREQ_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_frame(struct unicast_conn *c, const rimeaddr_t *from)
+{
+  dtn_freq_frame frame;
+
+  if(packetbuf_datalen() < sizeof(dtn_freq_frame)) {
+    return;
+  }
+  memcpy(&frame, packetbuf_dataptr(), sizeof(dtn_freq_frame));
+  if(frame.type == DTN_FREQ_ANSWER) {
+    if(state == FREQ_ASKED && rimeaddr_cmp(from, &peer) && frame.freq == freq) {
+      state = FREQ_AGREED;
+      process_poll(&freq_process);
+    }
+    return;
+  }
+  if(frame.type != DTN_FREQ_REQUEST) {
+    return;
+  }
+  ///Both asked each other at once, the lower address gives its transfer up and answers
+  if(state == FREQ_ASKED && rimeaddr_cmp(from, &peer) &&
+     (rimeaddr_node_addr.u8[0] < from->u8[0] ||
+      (rimeaddr_node_addr.u8[0] == from->u8[0] && rimeaddr_node_addr.u8[1] < from->u8[1]))) {
+    PRINTF("--- [FREQ] %d.%d asked us too, it goes first\n", from->u8[0], from->u8[1]);
+    state = FREQ_IDLE;
+  }
+  ///Anything else in progress, the neighbour hears nothing and tries at our next beacon
+  if(state != FREQ_IDLE) {
+    return;
+  }
+  freq = frame.freq;
+  rimeaddr_copy(&peer, from);
+  send_frame(DTN_FREQ_ANSWER, from);
+  state = FREQ_ANSWERED;
+  process_poll(&freq_process);
+}
+static const struct unicast_callbacks freq_callbacks = {recv_frame, NULL};
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(freq_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+  while(1) {
+    ///Every change of state polls, the timer is set here as it belongs to this process
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || ev == PROCESS_EVENT_TIMER);
+    if(ev == PROCESS_EVENT_TIMER) {
+      switch(state) {
+      case FREQ_ASKED:
+        PRINTF("--- [FREQ] No answer from %d.%d\n", peer.u8[0], peer.u8[1]);
+        state = FREQ_IDLE;
+        break;
+      case FREQ_AGREED:
+        DTN_FREQ_SET(freq);
+        state = FREQ_SENDING;
+        if(!freq_hooks->send(&peer)) {
+          back_to_control();
+        }
+        break;
+      case FREQ_ANSWERED:
+        DTN_FREQ_SET(freq);
+        state = FREQ_RECEIVING;
+        break;
+      case FREQ_RECEIVING:
+        back_to_control();
+        break;
+      }
+    }
+    switch(state) {
+    case FREQ_ASKED:
+      etimer_set(&et, DTN_FREQ_WAIT);
+      break;
+    case FREQ_AGREED:
+    case FREQ_ANSWERED:
+      etimer_set(&et, DTN_FREQ_GUARD);
+      break;
+    case FREQ_RECEIVING:
+      etimer_set(&et, DTN_FREQ_LINGER);
+      break;
+    default:
+      ///Runicast always ends a transfer we send with dtn_freq_done()
+      etimer_stop(&et);
+      break;
+    }
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_freq_open(const struct dtn_freq_hooks *hooks)
+{
+  freq_hooks = hooks;
+  state = FREQ_IDLE;
+  DTN_FREQ_SET(DTN_FREQ_CONTROL);
+  unicast_open(&freq_conn, DTN_FREQ_CHANNEL, &freq_callbacks);
+  process_start(&freq_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_freq_request(const rimeaddr_t *to)
+{
+  if(state != FREQ_IDLE) {
+    return;
+  }
+  freq = data_freqs[random_rand() % sizeof(data_freqs)];
+  rimeaddr_copy(&peer, to);
+  PRINTF("--- [FREQ] Asking %d.%d over to %d\n", to->u8[0], to->u8[1], freq);
+  send_frame(DTN_FREQ_REQUEST, to);
+  state = FREQ_ASKED;
+  process_poll(&freq_process);
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_freq_busy(void)
+{
+  return state != FREQ_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_freq_done(void)
+{
+  if(state == FREQ_SENDING) {
+    back_to_control();
+    process_poll(&freq_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_freq_heard(void)
+{
+  if(state == FREQ_RECEIVING) {
+    process_poll(&freq_process);
+  }
+}
+#endif /* DTN_FREQ */
@@ -0,0 +1,113 @@
+/**
+ * @file dtn-freq.h
+ * @author Archie Norman
+ * @brief Separate control and data frequencies. Beacons and everything else
+ * stay on DTN_FREQ_CONTROL, bundle transfers move to one of the
+ * DTN_FREQ_DATA radio channels so neighbouring contacts do not collide with
+ * each other or with the beacons. A node answering a beacon picks a data
+ * frequency and asks the beaconing node over a small unicast on the control
+ * frequency. If it answers, both retune after DTN_FREQ_GUARD, the runicast
+ * goes on the data frequency, and the sender comes back once it is
+ * acknowledged or timed out. The receiver comes back once nothing has
+ * arrived for DTN_FREQ_LINGER, long enough for a retransmission after a lost
+ * ack. A node that does not answer is busy on another frequency, its
+ * bundles wait for its next beacon. Enable with DTN_CONF_FREQ in
+ * project-conf.h.
+ */
+#ifndef __DTN_FREQ_H__
+#define __DTN_FREQ_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_FREQ
+#define DTN_FREQ DTN_CONF_FREQ
+#else
+#define DTN_FREQ 0
+#endif
+///802.15.4 channel every node listens on between transfers
+#ifdef DTN_FREQ_CONF_CONTROL
+#define DTN_FREQ_CONTROL DTN_FREQ_CONF_CONTROL
+#else
+#define DTN_FREQ_CONTROL 26
+#endif
+///802.15.4 channels transfers are spread over
+#ifdef DTN_FREQ_CONF_DATA
+#define DTN_FREQ_DATA DTN_FREQ_CONF_DATA
+#else
+#define DTN_FREQ_DATA {15, 20, 25}
+#endif
+///How long to wait for the neighbour to answer
+#ifdef DTN_FREQ_CONF_WAIT
+#define DTN_FREQ_WAIT DTN_FREQ_CONF_WAIT
+#else
+#define DTN_FREQ_WAIT (CLOCK_SECOND / 8)
+#endif
+///Left for the answer to clear the air before both retune
+#ifdef DTN_FREQ_CONF_GUARD
+#define DTN_FREQ_GUARD DTN_FREQ_CONF_GUARD
+#else
+#define DTN_FREQ_GUARD (CLOCK_SECOND / 32)
+#endif
+///How long a receiver stays on the data frequency after the last frame
+#ifdef DTN_FREQ_CONF_LINGER
+#define DTN_FREQ_LINGER DTN_FREQ_CONF_LINGER
+#else
+#define DTN_FREQ_LINGER (CLOCK_SECOND * 2)
+#endif
+///Rime channel for the requests and answers
+#ifdef DTN_FREQ_CONF_CHANNEL
+#define DTN_FREQ_CHANNEL DTN_FREQ_CONF_CHANNEL
+#else
+#define DTN_FREQ_CHANNEL 250
+#endif
+///Retunes the radio, every target names it differently
+#ifdef DTN_FREQ_CONF_SET
+#define DTN_FREQ_SET(f) DTN_FREQ_CONF_SET(f)
+#elif DTN_CONF_SIM
+#define DTN_FREQ_SET(f) dtn_sim_frequency(f)
+#elif DTN_CONF_REPLAY || DTN_CONF_BENCH
+///The native target has no radio to tune
+#define DTN_FREQ_SET(f)
+#elif defined(CONTIKI_TARGET_SKY)
+#define DTN_FREQ_SET(f) cc2420_set_channel(f)
+#else
+///The mc1322x on the OrisenPrime counts from 0 for channel 11
+#define DTN_FREQ_SET(f) set_channel((f) - 11)
+#endif
+#define DTN_FREQ_REQUEST 1
+#define DTN_FREQ_ANSWER  2
+///Asks a neighbour to move to a data frequency, or agrees to
+typedef struct
+{
+	uint8_t type;
+	uint8_t freq;
+}dtn_freq_frame;
+///The transfer side, provided by dtn.c
+struct dtn_freq_hooks
+{
+	///Both ends are on the data frequency, send the transfer, 0 if it could not go
+	int (* send)(const rimeaddr_t *to);
+};
+/*
+ * @brief Tune to the control frequency and start answering requests
+ * @param1 - the transfer hooks
+ */
+void dtn_freq_open(const struct dtn_freq_hooks *hooks);
+/*
+ * @brief Ask a neighbour to move to a data frequency for a transfer
+ * @param1 - the neighbour
+ */
+void dtn_freq_request(const rimeaddr_t *to);
+/*
+ * @brief Whether we are off the control frequency or waiting to leave it
+ */
+int dtn_freq_busy(void);
+/*
+ * @brief Our transfer was acknowledged or timed out, back to the control frequency
+ */
+void dtn_freq_done(void);
+/*
+ * @brief A transfer frame arrived, stay on the data frequency a while longer
+ */
+void dtn_freq_heard(void);
+
+#endif /* __DTN_FREQ_H__ */
@@ -0,0 +1,72 @@
+/**
+ * @file dtn-group.c
+ * @author Archie Norman
+ * @brief Group membership lookups for group addressed bundles.
+ */
+#include "dtn-group.h"
+
+#if DTN_GROUPS
+#ifdef DTN_GROUP_CONF_TABLE
+static const struct dtn_group groups[] = DTN_GROUP_CONF_TABLE;
+#else
+///Default test group 224.1, the three collectors used in the experiments
+static const struct dtn_group groups[] = {
+  {1, 3, {{{128, 1}}, {{128, 5}}, {{128, 9}}}}
+};
+#endif
+#define NUM_GROUPS ((int)(sizeof(groups) / sizeof(groups[0])))
+/*
+ * @brief Find a group in the table
+ * @param1 - the group address
+ */
+static const struct dtn_group *
+find_group(const rimeaddr_t *group)
+{
+  int i;
+  if(!dtn_group_is_group(group)) {
+    return NULL;
+  }
+  for(i = 0; i < NUM_GROUPS; i++) {
+    if(groups[i].id == group->u8[1]) {
+      return &groups[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+dtn_group_member_bit(const rimeaddr_t *group, const rimeaddr_t *node)
+{
+  const struct dtn_group *g;
+  int i;
+  g = find_group(group);
+  if(g == NULL) {
+    return 0;
+  }
+  for(i = 0; i < g->count; i++) {
+    if(rimeaddr_cmp(&g->members[i], node)) {
+      return 1 << i;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+dtn_group_all_members(const rimeaddr_t *group)
+{
+  const struct dtn_group *g;
+  g = find_group(group);
+  if(g == NULL) {
+    return 0;
+  }
+  return (uint8_t)((1 << g->count) - 1);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_group_first(rimeaddr_t *group)
+{
+  rimeaddr_copy(group, &rimeaddr_null);
+  group->u8[0] = DTN_GROUP_PREFIX;
+  group->u8[1] = groups[0].id;
+}
+#endif /* DTN_GROUPS */
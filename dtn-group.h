@@ -0,0 +1,62 @@
+/**
+ * @file dtn-group.h
+ * @author Archie Norman
+ * @brief Group addressed bundles. Destinations whose first address byte is
+ * DTN_GROUP_PREFIX name a group instead of a node, the second byte is the
+ * group id looked up in DTN_GROUP_TABLE. A single cached bundle serves every
+ * member, the members it has reached are kept as a bitmap in the reserved
+ * byte of its header so the bitmap travels with each copy. Enable with
+ * DTN_CONF_GROUPS in project-conf.h.
+ */
+#ifndef __DTN_GROUP_H__
+#define __DTN_GROUP_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_GROUPS
+#define DTN_GROUPS DTN_CONF_GROUPS
+#else
+#define DTN_GROUPS 0
+#endif
+///First address byte reserved for groups
+#ifdef DTN_GROUP_CONF_PREFIX
+#define DTN_GROUP_PREFIX DTN_GROUP_CONF_PREFIX
+#else
+#define DTN_GROUP_PREFIX 224
+#endif
+///The served bitmap is one byte, so a group has at most 8 members
+#define DTN_GROUP_MAX_MEMBERS 8
+/*
+ *Group id and member list, DTN_GROUP_CONF_TABLE takes an initialiser
+ *for an array of these, e.g.
+ *{ {1, 3, {{{128, 1}}, {{128, 2}}, {{128, 3}}}} }
+ */
+struct dtn_group
+{
+	uint8_t id;
+	uint8_t count;
+	rimeaddr_t members[DTN_GROUP_MAX_MEMBERS];
+};
+/*
+ * @brief Check if a destination is a group address
+ * @param1 - the destination
+ */
+#define dtn_group_is_group(dest) ((dest)->u8[0] == DTN_GROUP_PREFIX)
+/*
+ * @brief Find the bit a node has in a group's served bitmap
+ * @param1 - the group address
+ * @param2 - the node
+ * @return the bit, or 0 if the node is not a member
+ */
+uint8_t dtn_group_member_bit(const rimeaddr_t *group, const rimeaddr_t *node);
+/*
+ * @brief The served bitmap of a group once every member has the bundle
+ * @param1 - the group address
+ */
+uint8_t dtn_group_all_members(const rimeaddr_t *group);
+/*
+ * @brief The address of the first configured group, used for test bundles
+ * @param1 - where to write the address
+ */
+void dtn_group_first(rimeaddr_t *group);
+
+#endif /* __DTN_GROUP_H__ */
@@ -0,0 +1,92 @@
+/**
+ * @file dtn-link.c
+ * @author Archie Norman
+ * @brief Per neighbour retransmission averages, timeouts and backoff.
+ */
+#include "dtn-link.h"
+#include <stdio.h>
+
+#if DTN_LINK
+///The averages are kept in sixteenths of a retransmission
+#define SCALE 16
+static struct
+{
+	rimeaddr_t addr;
+	uint8_t average;
+	///Timeouts since the last acknowledgement
+	uint8_t failures;
+	struct timer backoff;
+}links[DTN_LINK_NEIGHBOURS];
+static uint8_t next_slot;
+/*
+ * @brief Find a neighbour's entry
+ * @param1 - the neighbour
+ * @param2 - whether to take a slot for it if there is none
+ */
+static int
+find(const rimeaddr_t *addr, int create)
+{
+  int i;
+  for(i = 0; i < DTN_LINK_NEIGHBOURS; i++) {
+    if(rimeaddr_cmp(&links[i].addr, addr)) {
+      return i;
+    }
+  }
+  if(!create) {
+    return -1;
+  }
+  ///Slots are reused round robin, a forgotten neighbour starts again from the maximum
+  i = next_slot;
+  next_slot = (next_slot + 1) % DTN_LINK_NEIGHBOURS;
+  rimeaddr_copy(&links[i].addr, addr);
+  links[i].average = (DTN_LINK_MAX_RETRANSMISSIONS - DTN_LINK_SLACK) * SCALE;
+  links[i].failures = 0;
+  timer_set(&links[i].backoff, 0);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_link_usable(const rimeaddr_t *to)
+{
+  int i = find(to, 0);
+  return i < 0 || links[i].failures == 0 || timer_expired(&links[i].backoff);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+dtn_link_retransmissions(const rimeaddr_t *to)
+{
+  int i = find(to, 0);
+  uint8_t limit;
+  if(i < 0) {
+    return DTN_LINK_MAX_RETRANSMISSIONS;
+  }
+  if(links[i].failures > 0) {
+    return DTN_LINK_MIN_RETRANSMISSIONS;
+  }
+  limit = (links[i].average + SCALE - 1) / SCALE + DTN_LINK_SLACK;
+  if(limit < DTN_LINK_MIN_RETRANSMISSIONS) {
+    limit = DTN_LINK_MIN_RETRANSMISSIONS;
+  }
+  return limit > DTN_LINK_MAX_RETRANSMISSIONS ? DTN_LINK_MAX_RETRANSMISSIONS : limit;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_link_acked(const rimeaddr_t *to, uint8_t retransmissions)
+{
+  int i = find(to, 1);
+  ///Moves a quarter of the way to the latest count
+  links[i].average = links[i].average - links[i].average / 4 + retransmissions * SCALE / 4;
+  links[i].failures = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_link_timedout(const rimeaddr_t *to)
+{
+  int i = find(to, 1);
+  if(links[i].failures < 255) {
+    links[i].failures++;
+  }
+  timer_set(&links[i].backoff, DTN_LINK_BACKOFF << (links[i].failures > 5 ? 4 : links[i].failures - 1));
+  PRINTF("--- [LINK] %d.%d timed out %d times, backing off\n", to->u8[0], to->u8[1], links[i].failures);
+}
+#endif /* DTN_LINK */
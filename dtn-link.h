@@ -0,0 +1,76 @@
+/**
+ * @file dtn-link.h
+ * @author Archie Norman
+ * @brief Adaptive runicast retransmissions. Every runicast used to allow
+ * MAX_RETRANSMISSIONS, so a contact that had just gone burnt four
+ * retransmission cycles before the channel was free again. We keep an
+ * average of the retransmissions each neighbour needed for its recent
+ * acknowledgements and allow that plus DTN_LINK_SLACK, a good link gets
+ * one or two attempts and a marginal one up to MAX_RETRANSMISSIONS. After
+ * a timeout a neighbour only gets DTN_LINK_MIN_RETRANSMISSIONS and is left
+ * alone for a backoff that doubles with every further timeout, the bundles
+ * stay in the cache for the next neighbour that beacons. Enable with
+ * DTN_CONF_LINK in project-conf.h.
+ */
+#ifndef __DTN_LINK_H__
+#define __DTN_LINK_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_LINK
+#define DTN_LINK DTN_CONF_LINK
+#else
+#define DTN_LINK 0
+#endif
+///Neighbours whose link history is kept
+#ifdef DTN_LINK_CONF_NEIGHBOURS
+#define DTN_LINK_NEIGHBOURS DTN_LINK_CONF_NEIGHBOURS
+#else
+#define DTN_LINK_NEIGHBOURS 8
+#endif
+///Retransmissions allowed above the average a neighbour needed
+#ifdef DTN_LINK_CONF_SLACK
+#define DTN_LINK_SLACK DTN_LINK_CONF_SLACK
+#else
+#define DTN_LINK_SLACK 1
+#endif
+///What a neighbour that last timed out gets
+#ifdef DTN_LINK_CONF_MIN_RETRANSMISSIONS
+#define DTN_LINK_MIN_RETRANSMISSIONS DTN_LINK_CONF_MIN_RETRANSMISSIONS
+#else
+#define DTN_LINK_MIN_RETRANSMISSIONS 1
+#endif
+///What an unknown or marginal neighbour gets
+#ifdef DTN_LINK_CONF_MAX_RETRANSMISSIONS
+#define DTN_LINK_MAX_RETRANSMISSIONS DTN_LINK_CONF_MAX_RETRANSMISSIONS
+#else
+#define DTN_LINK_MAX_RETRANSMISSIONS 4
+#endif
+///Backoff after the first timeout, doubled for each further one up to 16 times
+#ifdef DTN_LINK_CONF_BACKOFF
+#define DTN_LINK_BACKOFF DTN_LINK_CONF_BACKOFF
+#else
+#define DTN_LINK_BACKOFF (CLOCK_SECOND * 5)
+#endif
+/*
+ * @brief Whether a neighbour is worth sending to, or still backing off
+ * @param1 - the neighbour
+ */
+int dtn_link_usable(const rimeaddr_t *to);
+/*
+ * @brief The retransmissions to allow a runicast to a neighbour
+ * @param1 - the neighbour
+ */
+uint8_t dtn_link_retransmissions(const rimeaddr_t *to);
+/*
+ * @brief A runicast to a neighbour was acknowledged
+ * @param1 - the neighbour
+ * @param2 - the retransmissions it took
+ */
+void dtn_link_acked(const rimeaddr_t *to, uint8_t retransmissions);
+/*
+ * @brief A runicast to a neighbour timed out
+ * @param1 - the neighbour
+ */
+void dtn_link_timedout(const rimeaddr_t *to);
+
+#endif /* __DTN_LINK_H__ */
@@ -0,0 +1,324 @@
+/**
+ * @file dtn-multicast.c
+ * @author Archie Norman
+ * @brief The aggregation window, the frames and the table of shares waiting
+ * to be confirmed or repaired.
+ */
+#include "dtn-multicast.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#if DTN_MULTICAST
+PROCESS(multicast_process, "Multicast process");
+static struct broadcast_conn multicast_conn;
+static list_t messages;
+static const struct dtn_multicast_hooks *multicast_hooks;
+///The bundles picked for each neighbour heard in the window
+static struct
+{
+	rimeaddr_t addr;
+	uint8_t len;
+	dtn_msg_id ids[DTN_VECTOR_MESSAGES];
+}wants[DTN_MULTICAST_RECEIVERS];
+static uint8_t receivers;
+/*
+ *The frame being built or the one being read, never both at once. Not the
+ *core's scratch frame, every bundle read from it is handed to the core
+ *that builds its own packet there.
+ */
+static dtn_multicast_frame frame;
+///Shares sent in frames, until the receiver confirms them or is repaired
+static struct
+{
+	dtn_msg_id id;
+	rimeaddr_t to;
+	uint8_t copies;
+	uint8_t used;
+	struct timer expires;
+}repairs[DTN_MULTICAST_REPAIRS];
+/*
+ * @brief Compare two message ids
+ */
+static int
+msg_id_cmp(const dtn_msg_id *a, const dtn_msg_id *b)
+{
+  return rimeaddr_cmp(&a->src, &b->src) && rimeaddr_cmp(&a->dest, &b->dest) && a->seq == b->seq;
+}
+/*
+ * @brief Write off the shares left too long
+ */
+static void
+expire_repairs(void)
+{
+  int i;
+  for(i = 0; i < DTN_MULTICAST_REPAIRS; i++) {
+    if(repairs[i].used && timer_expired(&repairs[i].expires)) {
+      PRINTF("--- [MCAST] %d.%d never confirmed <%d.%d:%d>, its share is written off\n",
+        repairs[i].to.u8[0], repairs[i].to.u8[1],
+        repairs[i].id.src.u8[0], repairs[i].id.src.u8[1], repairs[i].id.seq);
+      repairs[i].used = 0;
+    }
+  }
+}
+/*
+ * @brief The repair slot of a share, -1 if none
+ */
+static int
+find_repair(const rimeaddr_t *to, const dtn_msg_id *id)
+{
+  int i;
+  expire_repairs();
+  for(i = 0; i < DTN_MULTICAST_REPAIRS; i++) {
+    if(repairs[i].used && rimeaddr_cmp(&repairs[i].to, to) && msg_id_cmp(&repairs[i].id, id)) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+free_repairs(void)
+{
+  int i, n = 0;
+  expire_repairs();
+  for(i = 0; i < DTN_MULTICAST_REPAIRS; i++) {
+    if(!repairs[i].used) {
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_repair(const rimeaddr_t *to, const dtn_msg_id *id, uint8_t copies)
+{
+  int i;
+  for(i = 0; i < DTN_MULTICAST_REPAIRS; i++) {
+    if(!repairs[i].used) {
+      repairs[i].used = 1;
+      repairs[i].id = *id;
+      rimeaddr_copy(&repairs[i].to, to);
+      repairs[i].copies = copies;
+      timer_set(&repairs[i].expires, DTN_MULTICAST_REPAIR_TIME);
+      return;
+    }
+  }
+}
+/*
+ * @brief Whether a neighbour's picks include a bundle, and take it out if so
+ */
+static int
+take(int w, const dtn_msg_id *id)
+{
+  int i;
+  for(i = 0; i < wants[w].len; i++) {
+    if(msg_id_cmp(&wants[w].ids[i], id)) {
+      wants[w].len--;
+      memmove(&wants[w].ids[i], &wants[w].ids[i + 1], (wants[w].len - i) * sizeof(dtn_msg_id));
+      return 1;
+    }
+  }
+  return 0;
+}
+/*
+ * @brief The window closed, put the bundles wanted by more than one
+ * neighbour in a frame and hand the rest back for runicast
+ */
+static void
+close_window(void)
+{
+  rimeaddr_t to[DTN_MULTICAST_RECEIVERS];
+  uint8_t slot[DTN_MULTICAST_RECEIVERS];
+  uint8_t copies[DTN_MULTICAST_RECEIVERS];
+  dtn_vector_list *tmp;
+  int w, j, k, n, room, max;
+
+  max = (PACKETBUF_SIZE - offsetof(dtn_multicast_frame, message)) / sizeof(dtn_message);
+  if(max > DTN_MULTICAST_BUNDLES) {
+    max = DTN_MULTICAST_BUNDLES;
+  }
+  room = free_repairs();
+  memset(&frame, 0, offsetof(dtn_multicast_frame, message));
+  n = 0;
+  for(tmp = list_head(messages); tmp != NULL && n < max && receivers > 1; tmp = list_item_next(tmp)) {
+    ///Take it out of every neighbour's picks, put back below if it does not go in the frame
+    k = 0;
+    for(w = 0; w < receivers; w++) {
+      if(take(w, &tmp->message.hdr.message_id)) {
+        rimeaddr_copy(&to[k], &wants[w].addr);
+        slot[k++] = w;
+      }
+    }
+    ///Its destination gets it by runicast, that is a delivery not a share
+    for(j = 0; j < k; j++) {
+      if(rimeaddr_cmp(&to[j], &tmp->message.hdr.message_id.dest)) {
+        break;
+      }
+    }
+    if(k < 2 || k > room || j < k || !multicast_hooks->split(&tmp->message, to, k, copies)) {
+      for(j = 0; j < k; j++) {
+        wants[slot[j]].ids[wants[slot[j]].len++] = tmp->message.hdr.message_id;
+      }
+      continue;
+    }
+    frame.message[n] = tmp->message;
+    for(j = 0; j < k; j++) {
+      frame.members[n] |= 1 << slot[j];
+      frame.copies[n][slot[j]] = copies[j];
+      add_repair(&to[j], &tmp->message.hdr.message_id, copies[j]);
+    }
+    room -= k;
+    n++;
+  }
+  if(n > 0) {
+    frame.header.type = DTN_MESSAGE;
+    frame.header.len = n;
+    frame.receivers = receivers;
+    for(w = 0; w < receivers; w++) {
+      rimeaddr_copy(&frame.to[w], &wants[w].addr);
+    }
+    PRINTF("--- [MCAST] %d bundles in one frame for %d neighbours\n", n, receivers);
+    packetbuf_copyfrom(&frame, offsetof(dtn_multicast_frame, message) + n * sizeof(dtn_message));
+    broadcast_send(&multicast_conn);
+  }
+  for(w = 0; w < receivers; w++) {
+    if(wants[w].len > 0) {
+      multicast_hooks->unicast(&wants[w].addr, wants[w].ids, wants[w].len);
+    }
+  }
+  receivers = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_frame(struct broadcast_conn *c, const rimeaddr_t *from)
+{
+  dtn_message message;
+  int r, i, len;
+
+  if(packetbuf_datalen() < offsetof(dtn_multicast_frame, message)) {
+    return;
+  }
+  memset(&frame, 0, sizeof(dtn_multicast_frame));
+  memcpy(&frame, packetbuf_dataptr(), packetbuf_datalen() < sizeof(dtn_multicast_frame) ?
+    packetbuf_datalen() : sizeof(dtn_multicast_frame));
+  ///Only the bundles that arrived whole, the rest of the frame is zeros
+  len = (packetbuf_datalen() - offsetof(dtn_multicast_frame, message)) / sizeof(dtn_message);
+  if(frame.header.len < len) {
+    len = frame.header.len;
+  }
+  for(r = 0; r < frame.receivers && r < DTN_MULTICAST_RECEIVERS; r++) {
+    if(rimeaddr_cmp(&frame.to[r], &rimeaddr_node_addr)) {
+      break;
+    }
+  }
+  if(r == frame.receivers || r == DTN_MULTICAST_RECEIVERS) {
+    return;
+  }
+  for(i = 0; i < len && i < DTN_MULTICAST_BUNDLES; i++) {
+    if(frame.members[i] & (1 << r)) {
+      message = frame.message[i];
+      message.hdr.number_of_copies = frame.copies[i][r];
+      PRINTF("--- [MCAST] <%d.%d:%d> from a frame by %d.%d\n", message.hdr.message_id.src.u8[0],
+        message.hdr.message_id.src.u8[1], message.hdr.message_id.seq, from->u8[0], from->u8[1]);
+      multicast_hooks->received(&message, from);
+    }
+  }
+}
+static const struct broadcast_callbacks multicast_callbacks = {recv_frame, NULL};
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(multicast_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL && receivers > 0);
+    etimer_set(&et, DTN_MULTICAST_WINDOW);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    close_window();
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_multicast_open(list_t m, const struct dtn_multicast_hooks *hooks)
+{
+  messages = m;
+  multicast_hooks = hooks;
+  broadcast_open(&multicast_conn, DTN_MULTICAST_CHANNEL, &multicast_callbacks);
+  process_start(&multicast_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_multicast_summary(const rimeaddr_t *from, const dtn_summary_vector *summary)
+{
+  int i, j;
+  for(i = 0; i < DTN_MULTICAST_REPAIRS; i++) {
+    if(!repairs[i].used || !rimeaddr_cmp(&repairs[i].to, from)) {
+      continue;
+    }
+    for(j = 0; j < summary->header.len; j++) {
+      if(msg_id_cmp(&summary->message_ids[j], &repairs[i].id)) {
+        repairs[i].used = 0;
+        break;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_multicast_owed(const rimeaddr_t *to, const dtn_msg_id *id, uint8_t *copies)
+{
+  int i = find_repair(to, id);
+  if(i < 0) {
+    return 0;
+  }
+  *copies = repairs[i].copies;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_multicast_offer(const rimeaddr_t *to, dtn_message *m, int len)
+{
+  int i, w, kept = 0;
+
+  for(w = 0; w < receivers; w++) {
+    if(rimeaddr_cmp(&wants[w].addr, to)) {
+      break;
+    }
+  }
+  if(w == DTN_MULTICAST_RECEIVERS) {
+    ///The window is full, this one goes straight away as before
+    return len;
+  }
+  wants[w].len = 0;
+  for(i = 0; i < len; i++) {
+    if(find_repair(to, &m[i].hdr.message_id) >= 0) {
+      m[kept++] = m[i];
+    }
+    else {
+      wants[w].ids[wants[w].len++] = m[i].hdr.message_id;
+    }
+  }
+  if(w == receivers && wants[w].len > 0) {
+    rimeaddr_copy(&wants[w].addr, to);
+    receivers++;
+    process_poll(&multicast_process);
+  }
+  return kept;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_multicast_repaired(const dtn_msg_id *id, const rimeaddr_t *to)
+{
+  int i = find_repair(to, id);
+  if(i < 0) {
+    return 0;
+  }
+  PRINTF("--- [MCAST] Repaired <%d.%d:%d> at %d.%d\n", id->src.u8[0], id->src.u8[1], id->seq,
+    to->u8[0], to->u8[1]);
+  repairs[i].used = 0;
+  return 1;
+}
+#endif /* DTN_MULTICAST */
@@ -0,0 +1,126 @@
+/**
+ * @file dtn-multicast.h
+ * @author Archie Norman
+ * @brief One-to-many transfers. When several neighbours beacon close
+ * together and are missing the same bundle, it used to go out in one
+ * runicast per neighbour. With this enabled the bundles picked for a
+ * neighbour are held for DTN_MULTICAST_WINDOW, every bundle more than one
+ * of the neighbours heard in that window is missing then goes out once in a
+ * broadcast frame listing its receivers, and the rest go by runicast as
+ * before. The copies the routing strategy would have handed to the
+ * receivers one after the other are shared evenly between them. Nothing
+ * acknowledges the frame, a receiver still listing the bundle as missing in
+ * its next beacon has missed it and is sent its share again by runicast.
+ * A share that is not confirmed or repaired within DTN_MULTICAST_REPAIR_TIME
+ * is written off rather than risk spraying copies twice. Enable with
+ * DTN_CONF_MULTICAST in project-conf.h.
+ */
+#ifndef __DTN_MULTICAST_H__
+#define __DTN_MULTICAST_H__
+#include "dtn.h"
+#include "lib/list.h"
+
+#ifdef DTN_CONF_MULTICAST
+#define DTN_MULTICAST DTN_CONF_MULTICAST
+#else
+#define DTN_MULTICAST 0
+#endif
+///How long the bundles picked for a neighbour wait for others to beacon
+#ifdef DTN_MULTICAST_CONF_WINDOW
+#define DTN_MULTICAST_WINDOW DTN_MULTICAST_CONF_WINDOW
+#else
+#define DTN_MULTICAST_WINDOW CLOCK_SECOND
+#endif
+///Neighbours one window and frame can serve, at most 8
+#ifdef DTN_MULTICAST_CONF_RECEIVERS
+#define DTN_MULTICAST_RECEIVERS DTN_MULTICAST_CONF_RECEIVERS
+#else
+#define DTN_MULTICAST_RECEIVERS 4
+#endif
+///Bundles in one frame, fewer go if they do not fit in the packet buffer
+#ifdef DTN_MULTICAST_CONF_BUNDLES
+#define DTN_MULTICAST_BUNDLES DTN_MULTICAST_CONF_BUNDLES
+#else
+#define DTN_MULTICAST_BUNDLES 4
+#endif
+///Shares handed out by frames and not yet confirmed
+#ifdef DTN_MULTICAST_CONF_REPAIRS
+#define DTN_MULTICAST_REPAIRS DTN_MULTICAST_CONF_REPAIRS
+#else
+#define DTN_MULTICAST_REPAIRS 8
+#endif
+///How long a receiver has to confirm or be repaired
+#ifdef DTN_MULTICAST_CONF_REPAIR_TIME
+#define DTN_MULTICAST_REPAIR_TIME DTN_MULTICAST_CONF_REPAIR_TIME
+#else
+#define DTN_MULTICAST_REPAIR_TIME (CLOCK_SECOND * 30)
+#endif
+///Broadcast channel for the frames
+#ifdef DTN_MULTICAST_CONF_CHANNEL
+#define DTN_MULTICAST_CHANNEL DTN_MULTICAST_CONF_CHANNEL
+#else
+#define DTN_MULTICAST_CHANNEL 249
+#endif
+
+#if DTN_MULTICAST_RECEIVERS > 8
+#error "DTN_MULTICAST_RECEIVERS has to fit the 8 bit member maps"
+#endif
+/*
+ *Bundles for several receivers in one frame. Only the first header.len
+ *bundles are sent.
+ */
+typedef struct
+{
+	dtn_header header;
+	uint8_t receivers;
+	rimeaddr_t to[DTN_MULTICAST_RECEIVERS];
+	///Bit r is set if to[r] takes the bundle
+	uint8_t members[DTN_MULTICAST_BUNDLES];
+	///The copies to[r] takes of each bundle
+	uint8_t copies[DTN_MULTICAST_BUNDLES][DTN_MULTICAST_RECEIVERS];
+	dtn_message message[DTN_MULTICAST_BUNDLES];
+}dtn_multicast_frame;
+///The cache side of multicasting, provided by dtn.c
+struct dtn_multicast_hooks
+{
+	///Shares a bundle's copies between receivers and keeps the rest, 0 if it has to go to each by runicast
+	int (* split)(dtn_message *message, const rimeaddr_t *to, uint8_t n, uint8_t *copies);
+	///Send a neighbour the bundles no other neighbour was missing
+	void (* unicast)(const rimeaddr_t *to, const dtn_msg_id *ids, uint8_t n);
+	///A bundle for us arrived in a frame
+	void (* received)(const dtn_message *message, const rimeaddr_t *from);
+};
+/*
+ * @brief Open the multicast channel
+ * @param1 - the message cache
+ * @param2 - the cache hooks
+ */
+void dtn_multicast_open(list_t messages, const struct dtn_multicast_hooks *hooks);
+/*
+ * @brief Confirm the shares a neighbour's beacon shows it received
+ * @param1 - the neighbour
+ * @param2 - its summary vector
+ */
+void dtn_multicast_summary(const rimeaddr_t *from, const dtn_summary_vector *summary);
+/*
+ * @brief Whether a neighbour is owed a share of a bundle from a frame it missed
+ * @param1 - the neighbour
+ * @param2 - the message id
+ * @param3 - set to the copies it is owed
+ */
+int dtn_multicast_owed(const rimeaddr_t *to, const dtn_msg_id *id, uint8_t *copies);
+/*
+ * @brief Hold back the bundles picked for a neighbour until the window closes
+ * @param1 - the neighbour
+ * @param2 - the bundles picked for it, repairs are left in place
+ * @param3 - how many
+ * @return the repairs left to send now
+ */
+int dtn_multicast_offer(const rimeaddr_t *to, dtn_message *messages, int len);
+/*
+ * @brief A runicast to a neighbour was acknowledged, clears a repaired share
+ * @return 1 if the bundle was a repair, its copies were already accounted for
+ */
+int dtn_multicast_repaired(const dtn_msg_id *id, const rimeaddr_t *to);
+
+#endif /* __DTN_MULTICAST_H__ */
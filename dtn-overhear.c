@@ -0,0 +1,99 @@
+/**
+ * @file dtn-overhear.c
+ * @author Archie Norman
+ * @brief The runicast sniffer and the hold-off process.
+ */
+#include "dtn-overhear.h"
+#include "lib/random.h"
+#include <stdio.h>
+
+#if DTN_OVERHEAR
+PROCESS(overhear_process, "Overhear process");
+static const struct dtn_overhear_hooks *overhear_hooks;
+static uint16_t overhear_channel;
+static uint8_t pending;
+/*
+ * @brief Called for every frame the radio passes up, before Rime hands it
+ * to its connection
+ */
+static void
+sniffed(void)
+{
+  const dtn_vector *vector;
+  const rimeaddr_t *to;
+  int i, len;
+
+  if(packetbuf_attr(PACKETBUF_ATTR_CHANNEL) != overhear_channel ||
+     packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) != PACKETBUF_ATTR_PACKET_TYPE_DATA) {
+    return;
+  }
+  to = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(rimeaddr_cmp(to, &rimeaddr_node_addr)) {
+    return;
+  }
+  vector = packetbuf_dataptr();
+  if(packetbuf_datalen() < sizeof(dtn_header) || vector->header.type != DTN_MESSAGE) {
+    return;
+  }
+  ///Only what was actually on the air, the header could say anything
+  len = (packetbuf_datalen() - sizeof(dtn_header)) / sizeof(dtn_message);
+  if(vector->header.len < len) {
+    len = vector->header.len;
+  }
+  ///Every frame is passed on, not only while a transfer is held, the neighbour state is kept up too
+  for(i = 0; i < len; i++) {
+    overhear_hooks->overheard(to, &vector->message[i].hdr.message_id);
+  }
+}
+RIME_SNIFFER(overhear_sniffer, sniffed, NULL);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(overhear_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL && pending);
+    etimer_set(&et, random_rand() % DTN_OVERHEAR_HOLDOFF + 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || !pending);
+    if(pending) {
+      pending = 0;
+      overhear_hooks->send();
+    }
+    else {
+      etimer_stop(&et);
+    }
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_overhear_open(uint16_t channel, const struct dtn_overhear_hooks *hooks)
+{
+  overhear_hooks = hooks;
+  overhear_channel = channel;
+  rime_sniffer_add(&overhear_sniffer);
+  process_start(&overhear_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_overhear_hold(void)
+{
+  pending = 1;
+  process_poll(&overhear_process);
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_overhear_pending(void)
+{
+  return pending;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_overhear_cancel(void)
+{
+  PRINTF("--- [OVERHEAR] Everything was overheard, transfer cancelled\n");
+  pending = 0;
+  process_poll(&overhear_process);
+}
+#endif /* DTN_OVERHEAR */
@@ -0,0 +1,57 @@
+/**
+ * @file dtn-overhear.h
+ * @author Archie Norman
+ * @brief Overhearing based redundancy suppression. When a node beacons, every
+ * neighbour holding a bundle it lacks used to answer straight away, so the
+ * same bundle often arrived from several of them at once. With this enabled
+ * a responder holds its transfer back for a random DTN_OVERHEAR_HOLDOFF and
+ * listens, through a Rime sniffer, to the data frames other neighbours send
+ * on the runicast channel. A bundle it hears going to the node it was about
+ * to answer is dropped from its transfer, and the transfer is cancelled once
+ * nothing is left. The radio has to pass up frames addressed to other nodes,
+ * e.g. NULLRDC_CONF_ADDRESS_FILTER 0. Enable with DTN_CONF_OVERHEAR in
+ * project-conf.h.
+ */
+#ifndef __DTN_OVERHEAR_H__
+#define __DTN_OVERHEAR_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_OVERHEAR
+#define DTN_OVERHEAR DTN_CONF_OVERHEAR
+#else
+#define DTN_OVERHEAR 0
+#endif
+///Longest a responder waits before sending, each picks a random part of it
+#ifdef DTN_OVERHEAR_CONF_HOLDOFF
+#define DTN_OVERHEAR_HOLDOFF DTN_OVERHEAR_CONF_HOLDOFF
+#else
+#define DTN_OVERHEAR_HOLDOFF (CLOCK_SECOND / 4)
+#endif
+///The transfer side, provided by dtn.c
+struct dtn_overhear_hooks
+{
+	///A neighbour sent a bundle to another node, whether or not a transfer is held
+	void (* overheard)(const rimeaddr_t *to, const dtn_msg_id *id);
+	///The hold-off is over, send what is left of the transfer
+	void (* send)(void);
+};
+/*
+ * @brief Start listening to the runicast channel
+ * @param1 - the runicast channel the bundles travel on
+ * @param2 - the transfer hooks
+ */
+void dtn_overhear_open(uint16_t channel, const struct dtn_overhear_hooks *hooks);
+/*
+ * @brief Hold a transfer back for a random part of DTN_OVERHEAR_HOLDOFF
+ */
+void dtn_overhear_hold(void);
+/*
+ * @brief Whether a transfer is being held back
+ */
+int dtn_overhear_pending(void);
+/*
+ * @brief Drop the held transfer, everything in it was overheard
+ */
+void dtn_overhear_cancel(void);
+
+#endif /* __DTN_OVERHEAR_H__ */
@@ -0,0 +1,270 @@
+/**
+ * @file dtn-plan.c
+ * @author Archie Norman
+ * @brief Earliest arrival routes over the contact plan, the next contacts are
+ * held in a fixed table and topped up from CFS as they end.
+ */
+#include "dtn-plan.h"
+#include "dtn-time.h"
+#include "cfs/cfs.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_PLAN
+#define NO_CONTACT 0xff
+static struct dtn_contact contacts[DTN_PLAN_MAX_CONTACTS];
+static uint8_t num_contacts;
+///Where the next unread contact is in the plan file, 0 once it has all been read
+static cfs_offset_t plan_offset;
+///Bumped whenever the table changes, routes from an older table are recomputed
+static uint8_t generation;
+///A kept route, hop is rimeaddr_null if the plan does not reach dest
+static struct
+{
+	rimeaddr_t dest;
+	rimeaddr_t hop;
+	uint8_t first;
+	uint8_t generation;
+	uint8_t used;
+}routes[DTN_PLAN_ROUTES];
+static uint8_t next_route;
+///Search state, static to keep it off the stack
+static uint32_t arrival[DTN_PLAN_MAX_CONTACTS];
+static uint8_t prev[DTN_PLAN_MAX_CONTACTS];
+static uint8_t done[DTN_PLAN_MAX_CONTACTS];
+/*
+ * @brief Read a little endian integer from a buffer
+ */
+static uint32_t
+get_le(const uint8_t *buf, uint8_t bytes)
+{
+  uint32_t value = 0;
+  int i;
+  for(i = bytes - 1; i >= 0; i--) {
+    value = (value << 8) | buf[i];
+  }
+  return value;
+}
+/*
+ * @brief Read contacts from the plan file until the table is full
+ * @return 1 if any were read
+ */
+static int
+load_contacts(void)
+{
+  uint8_t buf[DTN_PLAN_RECORD_LEN];
+  uint32_t now = dtn_time_now();
+  struct dtn_contact *c;
+  int fd, loaded = 0;
+
+  if(plan_offset == 0 || num_contacts == DTN_PLAN_MAX_CONTACTS) {
+    return 0;
+  }
+  ///Opened for each top up, CFS only has a few descriptors
+  fd = cfs_open(DTN_PLAN_FILE, CFS_READ);
+  if(fd < 0) {
+    plan_offset = 0;
+    return 0;
+  }
+  if(cfs_seek(fd, plan_offset, CFS_SEEK_SET) != plan_offset) {
+    cfs_close(fd);
+    plan_offset = 0;
+    return 0;
+  }
+  while(num_contacts < DTN_PLAN_MAX_CONTACTS) {
+    if(cfs_read(fd, buf, DTN_PLAN_RECORD_LEN) != DTN_PLAN_RECORD_LEN) {
+      plan_offset = 0;
+      break;
+    }
+    plan_offset += DTN_PLAN_RECORD_LEN;
+    c = &contacts[num_contacts];
+    c->start = get_le(buf, 4);
+    c->end = get_le(buf + 4, 4);
+    memcpy(&c->from, buf + 8, RIMEADDR_SIZE);
+    memcpy(&c->to, buf + 8 + RIMEADDR_SIZE, RIMEADDR_SIZE);
+    c->capacity = get_le(buf + 8 + 2 * RIMEADDR_SIZE, 2);
+    ///Contacts already over are skipped
+    if(c->end >= now && c->capacity > 0) {
+      num_contacts++;
+      loaded = 1;
+    }
+  }
+  cfs_close(fd);
+  return loaded;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_plan_open(void)
+{
+  uint8_t hdr[DTN_PLAN_HDR_LEN];
+  int fd;
+
+  num_contacts = 0;
+  plan_offset = 0;
+  fd = cfs_open(DTN_PLAN_FILE, CFS_READ);
+  if(fd < 0) {
+    printf("[PLAN] No contact plan in %s, spraying everything\n", DTN_PLAN_FILE);
+    return;
+  }
+  if(cfs_read(fd, hdr, DTN_PLAN_HDR_LEN) != DTN_PLAN_HDR_LEN ||
+     memcmp(hdr, DTN_PLAN_MAGIC, 4) != 0 || hdr[4] != DTN_PLAN_VERSION) {
+    printf("[PLAN] %s is not a version %d contact plan\n", DTN_PLAN_FILE, DTN_PLAN_VERSION);
+    cfs_close(fd);
+    return;
+  }
+  cfs_close(fd);
+  plan_offset = DTN_PLAN_HDR_LEN;
+  load_contacts();
+  generation++;
+  PRINTF("--- [PLAN] Loaded %d contacts\n", num_contacts);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_plan_refresh(void)
+{
+  uint32_t now = dtn_time_now();
+  int i, j, changed = 0;
+
+  for(i = 0, j = 0; i < num_contacts; i++) {
+    if(contacts[i].end >= now && contacts[i].capacity > 0) {
+      contacts[j++] = contacts[i];
+    }
+  }
+  if(j != num_contacts) {
+    num_contacts = j;
+    changed = 1;
+  }
+  if(load_contacts()) {
+    changed = 1;
+  }
+  if(changed) {
+    generation++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * @brief Earliest arrival search over the contacts, Dijkstra with a contact
+ * per vertex so a bundle only moves on to contacts that are still open
+ * @param1 - the destination
+ * @return the first contact of the route, or NO_CONTACT
+ */
+static uint8_t
+find_route(const rimeaddr_t *dest)
+{
+  uint32_t now = dtn_time_now(), t;
+  uint8_t best, i;
+
+  for(i = 0; i < num_contacts; i++) {
+    done[i] = 0;
+    prev[i] = NO_CONTACT;
+    arrival[i] = 0xffffffff;
+    ///Contacts dtn_plan_forwarded() used up are left until dtn_plan_refresh() drops them
+    if(rimeaddr_cmp(&contacts[i].from, &rimeaddr_node_addr) && contacts[i].end >= now && contacts[i].capacity > 0) {
+      arrival[i] = contacts[i].start > now ? contacts[i].start : now;
+    }
+  }
+  while(1) {
+    best = NO_CONTACT;
+    for(i = 0; i < num_contacts; i++) {
+      if(!done[i] && arrival[i] != 0xffffffff && (best == NO_CONTACT || arrival[i] < arrival[best])) {
+        best = i;
+      }
+    }
+    if(best == NO_CONTACT) {
+      return NO_CONTACT;
+    }
+    if(rimeaddr_cmp(&contacts[best].to, dest)) {
+      break;
+    }
+    done[best] = 1;
+    ///Contacts out of the node this one reaches, that are still open when we get there
+    for(i = 0; i < num_contacts; i++) {
+      if(done[i] || contacts[i].capacity == 0 || !rimeaddr_cmp(&contacts[i].from, &contacts[best].to) ||
+         contacts[i].end < arrival[best] || rimeaddr_cmp(&contacts[i].to, &rimeaddr_node_addr)) {
+        continue;
+      }
+      t = contacts[i].start > arrival[best] ? contacts[i].start : arrival[best];
+      if(t < arrival[i]) {
+        arrival[i] = t;
+        prev[i] = best;
+      }
+    }
+  }
+  ///Walk back to the first contact
+  while(prev[best] != NO_CONTACT) {
+    best = prev[best];
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_plan_next_hop(const rimeaddr_t *dest, rimeaddr_t *hop)
+{
+  uint32_t now = dtn_time_now();
+  int i;
+
+  for(i = 0; i < DTN_PLAN_ROUTES; i++) {
+    if(routes[i].used && rimeaddr_cmp(&routes[i].dest, dest)) {
+      break;
+    }
+  }
+  ///Kept routes stay good until the table changes or their first contact is over
+  if(i == DTN_PLAN_ROUTES || routes[i].generation != generation ||
+     (routes[i].first != NO_CONTACT && contacts[routes[i].first].end < now)) {
+    if(i == DTN_PLAN_ROUTES) {
+      i = next_route;
+      next_route = (next_route + 1) % DTN_PLAN_ROUTES;
+    }
+    routes[i].used = 1;
+    routes[i].dest = *dest;
+    routes[i].generation = generation;
+    routes[i].first = find_route(dest);
+    if(routes[i].first == NO_CONTACT) {
+      rimeaddr_copy(&routes[i].hop, &rimeaddr_null);
+    }
+    else {
+      rimeaddr_copy(&routes[i].hop, &contacts[routes[i].first].to);
+      PRINTF("--- [PLAN] Route to %d.%d via %d.%d from %lu\n", dest->u8[0], dest->u8[1],
+        routes[i].hop.u8[0], routes[i].hop.u8[1], (unsigned long)contacts[routes[i].first].start);
+    }
+  }
+  if(routes[i].first == NO_CONTACT) {
+    return 0;
+  }
+  rimeaddr_copy(hop, &routes[i].hop);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_plan_forwarded(const rimeaddr_t *dest, const rimeaddr_t *hop)
+{
+  uint32_t now = dtn_time_now();
+  int i;
+
+  for(i = 0; i < DTN_PLAN_ROUTES; i++) {
+    if(routes[i].used && routes[i].generation == generation && rimeaddr_cmp(&routes[i].dest, dest) &&
+       routes[i].first != NO_CONTACT && rimeaddr_cmp(&routes[i].hop, hop)) {
+      break;
+    }
+  }
+  if(i < DTN_PLAN_ROUTES) {
+    i = routes[i].first;
+  }
+  else {
+    ///Not on a kept route, charge whichever contact with the hop is open
+    for(i = 0; i < num_contacts; i++) {
+      if(rimeaddr_cmp(&contacts[i].from, &rimeaddr_node_addr) && rimeaddr_cmp(&contacts[i].to, hop) &&
+         contacts[i].start <= now && contacts[i].end >= now) {
+        break;
+      }
+    }
+    if(i == num_contacts) {
+      return;
+    }
+  }
+  if(contacts[i].capacity > 0 && --contacts[i].capacity == 0) {
+    ///Full, routes through it have to be found again
+    generation++;
+  }
+}
+#endif /* DTN_PLAN */
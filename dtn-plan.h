@@ -0,0 +1,90 @@
+/**
+ * @file dtn-plan.h
+ * @author Archie Norman
+ * @brief Contact plan routing for nodes that meet on a schedule. The plan is
+ * a list of contacts, each a time window in which one node can send a number
+ * of bundles to another, read from DTN_PLAN_FILE in CFS (plan.sh writes it
+ * from a text plan). A bundle whose destination the plan reaches goes whole
+ * to the next hop on its earliest arrival route instead of being sprayed,
+ * everything else is sprayed as usual. Enable with DTN_CONF_PLAN.
+ *
+ * Only the next DTN_PLAN_MAX_CONTACTS contacts are held in RAM, as they end
+ * the table is topped up from the file, which must be in start time order.
+ * Routes are kept per destination and only recomputed once their first
+ * contact is over or the table changes.
+ *
+ * The plan file, all fields little endian:
+ *
+ *   file header:    'D' 'T' 'N' 'P' | version
+ *   contact record: start (4) | end (4) | from address | to address | capacity (2)
+ *
+ * start and end are dtn_time_now() seconds, so with DTN_CONF_TIMESYNC the
+ * plan is in network time. Contacts are one way, capacity is in bundles.
+ */
+#ifndef __DTN_PLAN_H__
+#define __DTN_PLAN_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_PLAN
+#define DTN_PLAN DTN_CONF_PLAN
+#else
+#define DTN_PLAN 0
+#endif
+///Name of the contact plan in CFS
+#ifdef DTN_PLAN_CONF_FILE
+#define DTN_PLAN_FILE DTN_PLAN_CONF_FILE
+#else
+#define DTN_PLAN_FILE "dtn.plan"
+#endif
+///Contacts held in RAM, the route search is quadratic in this
+#ifdef DTN_PLAN_CONF_MAX_CONTACTS
+#define DTN_PLAN_MAX_CONTACTS DTN_PLAN_CONF_MAX_CONTACTS
+#else
+#define DTN_PLAN_MAX_CONTACTS 32
+#endif
+///Destinations whose routes are kept
+#ifdef DTN_PLAN_CONF_ROUTES
+#define DTN_PLAN_ROUTES DTN_PLAN_CONF_ROUTES
+#else
+#define DTN_PLAN_ROUTES 8
+#endif
+
+#define DTN_PLAN_MAGIC   "DTNP"
+#define DTN_PLAN_VERSION 1
+#define DTN_PLAN_HDR_LEN    (4 + 1)
+#define DTN_PLAN_RECORD_LEN (4 + 4 + RIMEADDR_SIZE + RIMEADDR_SIZE + 2)
+
+///A contact, capacity counts down as planned bundles are handed over
+struct dtn_contact
+{
+	uint32_t start;
+	uint32_t end;
+	rimeaddr_t from;
+	rimeaddr_t to;
+	uint16_t capacity;
+};
+/*
+ * @brief Load the first contacts of the plan
+ */
+void dtn_plan_open(void);
+/*
+ * @brief Drop the contacts that are over and top the table up from the plan,
+ * called once per beacon period
+ */
+void dtn_plan_refresh(void);
+/*
+ * @brief The next hop on the earliest arrival route to a destination
+ * @param1 - the destination
+ * @param2 - where to write the next hop
+ * @return 1 if the plan reaches the destination, 0 to spray as usual
+ */
+int dtn_plan_next_hop(const rimeaddr_t *dest, rimeaddr_t *hop);
+/*
+ * @brief A planned bundle was handed to its next hop, uses up a bundle of
+ * the contact's capacity
+ * @param1 - the destination
+ * @param2 - the next hop it went to
+ */
+void dtn_plan_forwarded(const rimeaddr_t *dest, const rimeaddr_t *hop);
+
+#endif /* __DTN_PLAN_H__ */
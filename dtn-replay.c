@@ -0,0 +1,148 @@
+/**
+ * @file dtn-replay.c
+ * @author Archie Norman
+ * @brief Reads a capture file through CFS (plain files on the native target)
+ * and calls the receive callbacks with each frame at its captured time.
+ */
+#include "dtn-replay.h"
+#include "dtn-capture.h"
+#include "dtn-api.h"
+#include "lib/random.h"
+#include "cfs/cfs.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_REPLAY
+static struct broadcast_conn *replay_bc;
+static const struct broadcast_callbacks *replay_bc_call;
+static struct runicast_conn *replay_uc;
+static const struct runicast_callbacks *replay_uc_call;
+///Tick rate of the node that wrote the capture
+static uint16_t tick_rate;
+///The capture, left open after the header by dtn_replay_init()
+static int fd = -1;
+///Time the header was read, record times are relative to it as in the capture
+static clock_time_t start;
+
+PROCESS(replay_process, "Replay process");
+/*
+ * @brief Read a little endian integer from the capture
+ * @param1 - the file descriptor
+ * @param2 - where to store the value
+ * @param3 - the number of bytes
+ */
+static int
+get_le(int fd, uint32_t *value, uint8_t bytes)
+{
+  uint8_t buf[4];
+  int i;
+  if(cfs_read(fd, buf, bytes) != bytes) {
+    return 0;
+  }
+  *value = 0;
+  for(i = bytes - 1; i >= 0; i--) {
+    *value = (*value << 8) | buf[i];
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_replay_init(void)
+{
+  uint8_t magic[4], version;
+  uint32_t value, seed;
+  rimeaddr_t node_addr;
+
+  fd = cfs_open(DTN_CAPTURE_FILE, CFS_READ);
+  if(fd < 0) {
+    printf("[REPLAY] Could not open %s\n", DTN_CAPTURE_FILE);
+    return;
+  }
+  ///Check the header before trusting anything else in the file
+  if(cfs_read(fd, magic, 4) != 4 || memcmp(magic, DTN_CAPTURE_MAGIC, 4) != 0 ||
+     cfs_read(fd, &version, 1) != 1 || cfs_read(fd, &node_addr, RIMEADDR_SIZE) != RIMEADDR_SIZE) {
+    printf("[REPLAY] %s is not a capture\n", DTN_CAPTURE_FILE);
+    cfs_close(fd);
+    fd = -1;
+    return;
+  }
+  ///Frames from another version would be read with the wrong layout
+  if(version != DTN_CAPTURE_VERSION) {
+    printf("[REPLAY] %s is a version %d capture, this build replays version %d\n",
+      DTN_CAPTURE_FILE, version, DTN_CAPTURE_VERSION);
+    cfs_close(fd);
+    fd = -1;
+    return;
+  }
+  get_le(fd, &seed, 2);
+  get_le(fd, &value, 2);
+  tick_rate = value > 0 ? value : CLOCK_SECOND;
+  ///Restore the captured seed and address so the protocol makes the same choices
+  random_init(seed);
+  rimeaddr_set_node_addr(&node_addr);
+  start = clock_time();
+  printf("[REPLAY] Node %d.%d | Seed %lu | Tick rate %u\n",
+    node_addr.u8[0], node_addr.u8[1], (unsigned long)seed, tick_rate);
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_replay_start(struct broadcast_conn *bc, const struct broadcast_callbacks *bc_call,
+                 struct runicast_conn *uc, const struct runicast_callbacks *uc_call)
+{
+  replay_bc = bc;
+  replay_bc_call = bc_call;
+  replay_uc = uc;
+  replay_uc_call = uc_call;
+  process_start(&replay_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(replay_process, ev, data)
+{
+  static struct etimer et;
+  static uint32_t at, frames, len;
+  static uint8_t kind, value;
+  static rimeaddr_t from;
+  static uint8_t payload[PACKETBUF_SIZE];
+
+  PROCESS_BEGIN();
+
+  if(fd < 0) {
+    PROCESS_EXIT();
+  }
+  frames = 0;
+  while(get_le(fd, &at, 4) &&
+        cfs_read(fd, &kind, 1) == 1 &&
+        cfs_read(fd, &from, RIMEADDR_SIZE) == RIMEADDR_SIZE &&
+        cfs_read(fd, &value, 1) == 1 &&
+        get_le(fd, &len, 2) && len <= PACKETBUF_SIZE &&
+        cfs_read(fd, payload, len) == len) {
+    ///Convert the captured ticks in case the host clock runs at a different rate
+    at = (uint32_t)((uint64_t)at * CLOCK_SECOND / tick_rate);
+    if(clock_time() - start < at) {
+      etimer_set(&et, at - (clock_time() - start));
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    }
+    if(kind == DTN_CAPTURE_BROADCAST || kind == DTN_CAPTURE_RUNICAST) {
+      packetbuf_clear();
+      packetbuf_copyfrom(payload, len);
+    }
+    if(kind == DTN_CAPTURE_BROADCAST) {
+      replay_bc_call->recv(replay_bc, &from);
+    } else if(kind == DTN_CAPTURE_RUNICAST) {
+      replay_uc_call->recv(replay_uc, &from, value);
+    } else if(kind == DTN_CAPTURE_SEND && len > 0) {
+      ///The priority goes first, then the bundle payload
+      dtn_send(&from, payload + 1, len - 1, value, payload[0]);
+    } else if(kind == DTN_CAPTURE_SENT) {
+      replay_uc_call->sent(replay_uc, &from, value);
+    } else if(kind == DTN_CAPTURE_TIMEDOUT) {
+      replay_uc_call->timedout(replay_uc, &from, value);
+    }
+    frames++;
+  }
+  cfs_close(fd);
+  fd = -1;
+  printf("[REPLAY] Done, %lu frames\n", (unsigned long)frames);
+  PROCESS_END();
+}
+#endif /* DTN_REPLAY */
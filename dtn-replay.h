@@ -0,0 +1,40 @@
+/**
+ * @file dtn-replay.h
+ * @author Archie Norman
+ * @brief Host side replay of a capture written by dtn-capture.c. Build the
+ * node for the native target with "make TARGET=native DTN_REPLAY=1" and run
+ * it next to a dtn.cap file, every captured frame is fed back in to the same
+ * receive callbacks at the same offset from start up, with the captured seed
+ * and node address restored first. Captured bundles are created again with
+ * dtn_send(), and captured runicast outcomes are handed to the sent and
+ * timed out callbacks in place of the native ones. Replay is only the same
+ * run for the core path, see dtn-capture.h for what is not captured.
+ */
+#ifndef __DTN_REPLAY_H__
+#define __DTN_REPLAY_H__
+#include "contiki.h"
+#include "net/rime.h"
+
+#ifdef DTN_CONF_REPLAY
+#define DTN_REPLAY DTN_CONF_REPLAY
+#else
+#define DTN_REPLAY 0
+#endif
+
+/*
+ * @brief Open the capture, restore its seed and node address and start the
+ * clock the frames are timed against. Called where dtn_capture_init() was so
+ * everything after it draws the same random numbers
+ */
+void dtn_replay_init(void);
+/*
+ * @brief Start the replay process
+ * @param1 - the broadcast connection captured broadcasts are delivered on
+ * @param2 - the broadcast callbacks
+ * @param3 - the runicast connection captured runicasts are delivered on
+ * @param4 - the runicast callbacks
+ */
+void dtn_replay_start(struct broadcast_conn *bc, const struct broadcast_callbacks *bc_call,
+                      struct runicast_conn *uc, const struct runicast_callbacks *uc_call);
+
+#endif /* __DTN_REPLAY_H__ */
@@ -0,0 +1,35 @@
+/**
+ * @file dtn-route-binary.c
+ * @author Archie Norman
+ * @brief Binary Spray and Wait, each hop hands over half of its copies and
+ * the last copy is only given to the destination.
+ */
+#include "dtn-route.h"
+
+#if DTN_ROUTE == DTN_ROUTE_BINARY
+static int
+should_forward(const dtn_message *message, const rimeaddr_t *to)
+{
+  ///With one copy left we are waiting for the destination, a bundle left with none is too
+  return message->hdr.number_of_copies > 1 || rimeaddr_cmp(&message->hdr.message_id.dest, to);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hand_over(const dtn_message *message, const rimeaddr_t *to)
+{
+  ///Never send a 0, the last copy goes whole
+  if(message->hdr.number_of_copies != 1) {
+    return message->hdr.number_of_copies / 2;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+on_ack(const dtn_message *message, const rimeaddr_t *to)
+{
+  ///The neighbour took N / 2, we keep the rest so an odd copy is not lost
+  return message->hdr.number_of_copies - message->hdr.number_of_copies / 2;
+}
+/*---------------------------------------------------------------------------*/
+const struct dtn_route_strategy dtn_route = {"binary spray and wait", should_forward, hand_over, on_ack, NULL};
+#endif /* DTN_ROUTE == DTN_ROUTE_BINARY */
@@ -0,0 +1,29 @@
+/**
+ * @file dtn-route-direct.c
+ * @author Archie Norman
+ * @brief Direct delivery, the source holds a bundle until it meets the
+ * destination, the lower bound on overhead.
+ */
+#include "dtn-route.h"
+
+#if DTN_ROUTE == DTN_ROUTE_DIRECT
+static int
+should_forward(const dtn_message *message, const rimeaddr_t *to)
+{
+  return rimeaddr_cmp(&message->hdr.message_id.dest, to);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hand_over(const dtn_message *message, const rimeaddr_t *to)
+{
+  return message->hdr.number_of_copies;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+on_ack(const dtn_message *message, const rimeaddr_t *to)
+{
+  return message->hdr.number_of_copies;
+}
+/*---------------------------------------------------------------------------*/
+const struct dtn_route_strategy dtn_route = {"direct delivery", should_forward, hand_over, on_ack, NULL};
+#endif /* DTN_ROUTE == DTN_ROUTE_DIRECT */
@@ -0,0 +1,29 @@
+/**
+ * @file dtn-route-epidemic.c
+ * @author Archie Norman
+ * @brief Epidemic routing, a bundle goes to every neighbour that is missing
+ * it, copies are not counted.
+ */
+#include "dtn-route.h"
+
+#if DTN_ROUTE == DTN_ROUTE_EPIDEMIC
+static int
+should_forward(const dtn_message *message, const rimeaddr_t *to)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hand_over(const dtn_message *message, const rimeaddr_t *to)
+{
+  return message->hdr.number_of_copies;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+on_ack(const dtn_message *message, const rimeaddr_t *to)
+{
+  return message->hdr.number_of_copies;
+}
+/*---------------------------------------------------------------------------*/
+const struct dtn_route_strategy dtn_route = {"epidemic", should_forward, hand_over, on_ack, NULL};
+#endif /* DTN_ROUTE == DTN_ROUTE_EPIDEMIC */
@@ -0,0 +1,32 @@
+/**
+ * @file dtn-route-source.c
+ * @author Archie Norman
+ * @brief Source Spray and Wait, the source hands a single copy to each
+ * neighbour it meets until it has one left, relays only deliver.
+ */
+#include "dtn-route.h"
+
+#if DTN_ROUTE == DTN_ROUTE_SOURCE
+static int
+should_forward(const dtn_message *message, const rimeaddr_t *to)
+{
+  return message->hdr.number_of_copies > 1 || rimeaddr_cmp(&message->hdr.message_id.dest, to);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hand_over(const dtn_message *message, const rimeaddr_t *to)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+on_ack(const dtn_message *message, const rimeaddr_t *to)
+{
+  if(message->hdr.number_of_copies > 1) {
+    return message->hdr.number_of_copies - 1;
+  }
+  return message->hdr.number_of_copies;
+}
+/*---------------------------------------------------------------------------*/
+const struct dtn_route_strategy dtn_route = {"source spray and wait", should_forward, hand_over, on_ack, NULL};
+#endif /* DTN_ROUTE == DTN_ROUTE_SOURCE */
@@ -0,0 +1,45 @@
+/**
+ * @file dtn-route.h
+ * @author Archie Norman
+ * @brief Routing strategies. The forwarding decisions for ordinary bundles
+ * (those not routed by a contact plan or addressed to a group) are made by
+ * the strategy selected at build time, so protocols can be compared on the
+ * same firmware and traffic. Each strategy is its own dtn-route-*.c module,
+ * pick one with DTN_CONF_ROUTE in project-conf.h or "make DTN_ROUTE=EPIDEMIC".
+ *
+ *   DTN_ROUTE_BINARY    binary Spray and Wait, half the copies go each hop (default)
+ *   DTN_ROUTE_SOURCE    source Spray and Wait, the source hands out one copy at a time
+ *   DTN_ROUTE_EPIDEMIC  every neighbour missing a bundle gets it
+ *   DTN_ROUTE_DIRECT    bundles only go to their destination
+ */
+#ifndef __DTN_ROUTE_H__
+#define __DTN_ROUTE_H__
+#include "dtn.h"
+
+#define DTN_ROUTE_BINARY   1
+#define DTN_ROUTE_SOURCE   2
+#define DTN_ROUTE_EPIDEMIC 3
+#define DTN_ROUTE_DIRECT   4
+
+#ifdef DTN_CONF_ROUTE
+#define DTN_ROUTE DTN_CONF_ROUTE
+#else
+#define DTN_ROUTE DTN_ROUTE_BINARY
+#endif
+
+struct dtn_route_strategy
+{
+	const char *name;
+	///Whether a bundle a neighbour is missing goes to it
+	int (* should_forward)(const dtn_message *message, const rimeaddr_t *to);
+	///The copies handed over with it
+	uint8_t (* hand_over)(const dtn_message *message, const rimeaddr_t *to);
+	///The copies we keep once the neighbour acknowledged it
+	uint8_t (* on_ack)(const dtn_message *message, const rimeaddr_t *to);
+	///A runicast to the neighbour timed out, may be NULL
+	void (* on_timeout)(const rimeaddr_t *to);
+};
+///The strategy built in, defined by the selected dtn-route-*.c
+extern const struct dtn_route_strategy dtn_route;
+
+#endif /* __DTN_ROUTE_H__ */
@@ -0,0 +1,166 @@
+/**
+ * @file dtn-sample.c
+ * @author Archie Norman
+ * @brief Sensor ring buffers, batch sealing and the delta encoding of a batch.
+ */
+#include "dtn-sample.h"
+#include "dtn-api.h"
+#include "hmc5883l.h"
+#include <stdio.h>
+
+#if DTN_SAMPLE
+PROCESS(sample_process, "Sensor sampling process");
+#ifdef DTN_SAMPLE_CONF_SENSORS
+static const struct dtn_sample_sensor sensors[] = DTN_SAMPLE_CONF_SENSORS;
+#else
+///Default is the magnetometer on the OrisenPrime board
+static const struct dtn_sample_sensor sensors[] = {
+  {&hmc5883l_sensor, 0, CLOCK_SECOND * 10, 16}
+};
+#endif
+#define NUM_SENSORS (sizeof(sensors) / sizeof(sensors[0]))
+static const rimeaddr_t sample_dest = DTN_SAMPLE_DEST;
+///Readings of one sensor not yet sealed in to a bundle
+static struct
+{
+	int16_t values[DTN_SAMPLE_RING];
+	uint8_t first;
+	uint8_t count;
+	///When the first reading was taken
+	clock_time_t taken;
+	struct timer due;
+}rings[NUM_SENSORS];
+/*
+ * @brief Encode as many buffered readings of a sensor as fit in a payload
+ * @param1 - the sensor
+ * @param2 - where to write the payload, MAX_MSG_SIZE bytes
+ * @param3 - set to the number of readings encoded
+ * @return the payload length
+ */
+static uint8_t
+encode(uint8_t s, uint8_t *out, uint8_t *encoded)
+{
+  uint8_t len = DTN_SAMPLE_HEADER_LEN, n, size;
+  int16_t prev, cur;
+  uint16_t z, age, interval;
+
+  prev = rings[s].values[rings[s].first];
+  for(n = 1; n < rings[s].count; n++) {
+    cur = rings[s].values[(rings[s].first + n) % DTN_SAMPLE_RING];
+    ///Zigzag so small negative deltas are small too, the difference wraps like the decoder's sum
+    z = (uint16_t)(cur - prev);
+    z = (z << 1) ^ ((z & 0x8000) ? 0xffff : 0);
+    size = z < 0x80 ? 1 : z < 0x4000 ? 2 : 3;
+    if(len + size > MAX_MSG_SIZE) {
+      break;
+    }
+    while(z >= 0x80) {
+      out[len++] = (z & 0x7f) | 0x80;
+      z >>= 7;
+    }
+    out[len++] = z;
+    prev = cur;
+  }
+  interval = sensors[s].interval / CLOCK_SECOND;
+  age = (clock_time() - rings[s].taken) / CLOCK_SECOND;
+  out[0] = DTN_SAMPLE_MAGIC;
+  out[1] = s;
+  out[2] = n;
+  out[3] = interval > 0xff ? 0xff : interval;
+  out[4] = age & 0xff;
+  out[5] = age >> 8;
+  out[6] = rings[s].values[rings[s].first] & 0xff;
+  out[7] = (uint16_t)rings[s].values[rings[s].first] >> 8;
+  *encoded = n;
+  return len;
+}
+/*
+ * @brief Seal the buffered readings of a sensor in to a bundle if its batch
+ * is complete, the oldest is too old or the next reading would not fit
+ * @param1 - the sensor
+ */
+static void
+seal(uint8_t s)
+{
+  static uint8_t payload[MAX_MSG_SIZE];
+  uint8_t len, n, batch;
+
+  if(rings[s].count == 0) {
+    return;
+  }
+  batch = sensors[s].batch < DTN_SAMPLE_RING ? sensors[s].batch : DTN_SAMPLE_RING;
+  len = encode(s, payload, &n);
+  if(rings[s].count < batch && n == rings[s].count &&
+     clock_time() - rings[s].taken < DTN_SAMPLE_MAX_AGE) {
+    return;
+  }
+  PRINTF("--- [SAMPLE] Sealing %d readings of sensor %d in %d bytes\n", n, s, len);
+  dtn_send(&sample_dest, payload, len, 0, DTN_PRIORITY_NORMAL);
+  rings[s].first = (rings[s].first + n) % DTN_SAMPLE_RING;
+  rings[s].count -= n;
+  rings[s].taken += n * sensors[s].interval;
+}
+/*
+ * @brief Read a sensor in to its ring
+ * @param1 - the sensor
+ */
+static void
+sample(uint8_t s)
+{
+  if(rings[s].count == DTN_SAMPLE_RING) {
+    ///Only when a batch could not be sealed, lose the oldest
+    rings[s].first = (rings[s].first + 1) % DTN_SAMPLE_RING;
+    rings[s].count--;
+    rings[s].taken += sensors[s].interval;
+  }
+  if(rings[s].count == 0) {
+    rings[s].taken = clock_time();
+  }
+  rings[s].values[(rings[s].first + rings[s].count) % DTN_SAMPLE_RING] =
+    sensors[s].sensor->value(sensors[s].type);
+  rings[s].count++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sample_process, ev, data)
+{
+  static struct etimer et;
+  static uint8_t s;
+  clock_time_t next, left;
+
+  PROCESS_BEGIN();
+  for(s = 0; s < NUM_SENSORS; s++) {
+    SENSORS_ACTIVATE(*sensors[s].sensor);
+    timer_set(&rings[s].due, sensors[s].interval);
+  }
+  while(1) {
+    ///Sleep until the next reading or the next batch to age out
+    next = DTN_SAMPLE_MAX_AGE;
+    for(s = 0; s < NUM_SENSORS; s++) {
+      if(timer_expired(&rings[s].due)) {
+        timer_reset(&rings[s].due);
+        sample(s);
+      }
+      seal(s);
+      left = timer_remaining(&rings[s].due);
+      if(left < next) {
+        next = left;
+      }
+      if(rings[s].count > 0) {
+        left = DTN_SAMPLE_MAX_AGE - (clock_time() - rings[s].taken);
+        if(left < next) {
+          next = left;
+        }
+      }
+    }
+    etimer_set(&et, next > 0 ? next : 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_sample_open(void)
+{
+  process_start(&sample_process, NULL);
+}
+#endif /* DTN_SAMPLE */
@@ -0,0 +1,69 @@
+/**
+ * @file dtn-sample.h
+ * @author Archie Norman
+ * @brief Sensor sampling. Each sensor in DTN_SAMPLE_SENSORS is read at its own
+ * interval in to a small ring buffer, once it holds the sensor's batch of
+ * readings (or the oldest reading is DTN_SAMPLE_MAX_AGE old, or no more will
+ * fit in a bundle) they are sealed in to one bundle for DTN_SAMPLE_DEST. The
+ * payload is a short header and the first reading, every later reading is a
+ * zigzag varint delta from the one before, so a slowly changing sensor costs
+ * about a byte a reading and the bundle header is paid once per batch rather
+ * than once per reading. Enable with DTN_CONF_SAMPLE, raise
+ * DTN_CONF_MAX_MSG_SIZE so a bundle has room for a batch.
+ */
+#ifndef __DTN_SAMPLE_H__
+#define __DTN_SAMPLE_H__
+#include "dtn.h"
+#include "lib/sensors.h"
+
+#ifdef DTN_CONF_SAMPLE
+#define DTN_SAMPLE DTN_CONF_SAMPLE
+#else
+#define DTN_SAMPLE 0
+#endif
+///Readings buffered per sensor, a batch never holds more than this
+#ifdef DTN_SAMPLE_CONF_RING
+#define DTN_SAMPLE_RING DTN_SAMPLE_CONF_RING
+#else
+#define DTN_SAMPLE_RING 32
+#endif
+///Oldest a buffered reading gets before its batch is sealed anyway
+#ifdef DTN_SAMPLE_CONF_MAX_AGE
+#define DTN_SAMPLE_MAX_AGE DTN_SAMPLE_CONF_MAX_AGE
+#else
+#define DTN_SAMPLE_MAX_AGE (CLOCK_SECOND * 600)
+#endif
+///Where sensor bundles go, the collector used in the experiments
+#ifdef DTN_SAMPLE_CONF_DEST
+#define DTN_SAMPLE_DEST DTN_SAMPLE_CONF_DEST
+#else
+#define DTN_SAMPLE_DEST {{128, 9}}
+#endif
+///First payload byte of a sensor bundle, test bundles are text so never start with it
+#define DTN_SAMPLE_MAGIC 0xd5
+///magic, sensor, count, interval (s), age (s, 2 bytes), first reading (2 bytes)
+#define DTN_SAMPLE_HEADER_LEN 8
+
+#if DTN_SAMPLE && MAX_MSG_SIZE < DTN_SAMPLE_HEADER_LEN + 2
+#error "DTN_CONF_SAMPLE needs DTN_CONF_MAX_MSG_SIZE of at least 10"
+#endif
+/*
+ *A sensor to sample, DTN_SAMPLE_CONF_SENSORS takes an initialiser
+ *for an array of these, e.g. the magnetometer every 10s, 16 a bundle
+ *{ {&hmc5883l_sensor, 0, CLOCK_SECOND * 10, 16} }
+ */
+struct dtn_sample_sensor
+{
+	const struct sensors_sensor *sensor;
+	///Passed to the sensor's value()
+	int type;
+	clock_time_t interval;
+	///Readings aggregated in to each bundle
+	uint8_t batch;
+};
+/*
+ * @brief Activate the sensors and start sampling, sealed batches go out through dtn_send()
+ */
+void dtn_sample_open(void);
+
+#endif /* __DTN_SAMPLE_H__ */
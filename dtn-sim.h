@@ -0,0 +1,47 @@
+/**
+ * @file dtn-sim.h
+ * @author Archie Norman
+ * @brief Host simulator hooks. sim/ builds dtn.c and the protocol modules
+ * against a small in-process stand in for Contiki and Rime, with one copy of
+ * the protocol state per simulated node. Bundles are created by the
+ * simulator's traffic model instead of the buttons and deliveries are
+ * reported back for its statistics, the [MSG-CRT]/[RCV-RCH] records are
+ * printed as usual. DTN_CONF_SIM is set by sim/Makefile, usage is in
+ * sim/sim.c.
+ */
+#ifndef __DTN_SIM_H__
+#define __DTN_SIM_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_SIM
+#define DTN_SIM DTN_CONF_SIM
+#else
+#define DTN_SIM 0
+#endif
+///What the simulator needs from dtn.c
+struct dtn_sim_hooks
+{
+	///Create a bundle at this node
+	void (* create)(const rimeaddr_t *dest, uint8_t copies);
+	///dtn.c's transmission counters
+	int *unicasts;
+	int *acks;
+	int *timeouts;
+};
+/*
+ * @brief Hand the protocol over to the simulator, sets the node address
+ * @param1 - the hooks
+ */
+void dtn_sim_start(const struct dtn_sim_hooks *hooks);
+/*
+ * @brief Report a bundle that reached this node as its destination
+ * @param1 - the bundle
+ */
+void dtn_sim_delivered(const dtn_message *message);
+/*
+ * @brief Retune the simulated radio, see dtn-freq.h
+ * @param1 - the 802.15.4 channel
+ */
+void dtn_sim_frequency(uint8_t freq);
+
+#endif /* __DTN_SIM_H__ */
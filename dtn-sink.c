@@ -0,0 +1,255 @@
+/**
+ * @file dtn-sink.c
+ * @author Archie Norman
+ * @brief Batches delivered bundles over SLIP to the host collector, one batch
+ * is in flight at a time and is resent until the collector acknowledges it.
+ */
+#include "dtn-sink.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/crc16.h"
+#include "dev/slip.h"
+#include "dev/uart1.h"
+#include <stdio.h>
+#include <string.h>
+
+#if DTN_SINK
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+///An ack is three bytes and a crc
+#define ACK_LEN 5
+
+struct sink_entry
+{
+	struct sink_entry *next;
+	rimeaddr_t from;
+	dtn_message message;
+};
+MEMB(sink_memb, struct sink_entry, DTN_SINK_QUEUE);
+LIST(sink_list);
+
+PROCESS(sink_process, "Sink process");
+
+static void (* sink_room)(void);
+///Sequence number and size of the batch waiting for an ack, inflight is 0 when there is none
+static uint8_t batch_seq;
+static uint8_t inflight;
+///Set once the collector has acked our reset
+static uint8_t synced;
+///Written by the uart interrupt, read by the sink process
+static uint8_t rx_buf[ACK_LEN];
+static uint8_t rx_len, rx_esc;
+static volatile uint8_t rx_ready;
+/*
+ * @brief Write one byte SLIP escaped
+ * @param1 - the byte
+ */
+static void
+slip_put(uint8_t c)
+{
+  if(c == SLIP_END) {
+    DTN_SINK_CONF_WRITEB(SLIP_ESC);
+    c = SLIP_ESC_END;
+  } else if(c == SLIP_ESC) {
+    DTN_SINK_CONF_WRITEB(SLIP_ESC);
+    c = SLIP_ESC_ESC;
+  }
+  DTN_SINK_CONF_WRITEB(c);
+}
+///Write a byte of the frame and add it to the crc
+#define PUT(c) do { crc = crc16_add((c), crc); slip_put(c); } while(0)
+/*
+ * @brief Send the first inflight bundles of the queue as one batch
+ */
+static void
+send_batch(void)
+{
+  struct sink_entry *e;
+  uint16_t crc = 0;
+  uint8_t i, len, n;
+  uint32_t timestamp;
+
+  DTN_SINK_CONF_WRITEB(SLIP_END);
+  PUT(DTN_SINK_FRAME_BATCH);
+  PUT(batch_seq);
+  PUT(inflight);
+  for(e = list_head(sink_list), i = 0; e != NULL && i < inflight; e = list_item_next(e), i++) {
+    PUT(e->from.u8[0]);
+    PUT(e->from.u8[1]);
+    PUT(e->message.hdr.message_id.src.u8[0]);
+    PUT(e->message.hdr.message_id.src.u8[1]);
+    PUT(e->message.hdr.message_id.dest.u8[0]);
+    PUT(e->message.hdr.message_id.dest.u8[1]);
+    PUT(e->message.hdr.message_id.seq);
+    PUT(e->message.hdr.number_of_copies);
+    timestamp = e->message.hdr.timestamp;
+    PUT(timestamp & 0xff);
+    PUT((timestamp >> 8) & 0xff);
+    PUT((timestamp >> 16) & 0xff);
+    PUT((timestamp >> 24) & 0xff);
+    ///Sensor payloads are binary, so go by the length rather than a terminator
+    n = e->message.hdr.length < MAX_MSG_SIZE ? e->message.hdr.length : MAX_MSG_SIZE;
+    PUT(n);
+    for(len = 0; len < n; len++) {
+      PUT(e->message.msg[len]);
+    }
+  }
+  ///The crc itself is not part of the crc
+  slip_put(crc & 0xff);
+  slip_put(crc >> 8);
+  DTN_SINK_CONF_WRITEB(SLIP_END);
+}
+/*
+ * @brief Tell the collector the batch seq starts again
+ */
+static void
+send_reset(void)
+{
+  uint16_t crc = 0;
+
+  DTN_SINK_CONF_WRITEB(SLIP_END);
+  PUT(DTN_SINK_FRAME_RESET);
+  PUT(batch_seq);
+  slip_put(crc & 0xff);
+  slip_put(crc >> 8);
+  DTN_SINK_CONF_WRITEB(SLIP_END);
+}
+/*
+ * @brief Whether the frame from the collector is an intact ack for batch_seq
+ */
+static int
+intact_ack(void)
+{
+  return rx_buf[0] == DTN_SINK_FRAME_ACK && rx_buf[1] == batch_seq &&
+    crc16_data(rx_buf, 3, 0) == (rx_buf[3] | (rx_buf[4] << 8));
+}
+/*
+ * @brief Uart input handler, decodes SLIP frames from the collector
+ * @param1 - the received byte
+ */
+static int
+sink_input_byte(unsigned char c)
+{
+  if(c == SLIP_END) {
+    if(rx_len == ACK_LEN && !rx_ready) {
+      rx_ready = 1;
+      process_poll(&sink_process);
+    }
+    rx_len = 0;
+    rx_esc = 0;
+    return 1;
+  }
+  if(rx_esc) {
+    rx_esc = 0;
+    c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+  } else if(c == SLIP_ESC) {
+    rx_esc = 1;
+    return 1;
+  }
+  ///Anything longer than an ack is not for us
+  if(rx_len < ACK_LEN && !rx_ready) {
+    rx_buf[rx_len] = c;
+  }
+  if(rx_len <= ACK_LEN) {
+    rx_len++;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_sink_init(void (* room)(void))
+{
+  sink_room = room;
+  memb_init(&sink_memb);
+  list_init(sink_list);
+  DTN_SINK_CONF_SET_INPUT(sink_input_byte);
+  process_start(&sink_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_sink_deliver(const dtn_message *message, const rimeaddr_t *from)
+{
+  struct sink_entry *e;
+
+  e = memb_alloc(&sink_memb);
+  if(e == NULL) {
+    return 0;
+  }
+  rimeaddr_copy(&e->from, from);
+  memcpy(&e->message, message, sizeof(dtn_message));
+  list_add(sink_list, e);
+  process_poll(&sink_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  static struct etimer flush, retry, hold;
+  struct sink_entry *e;
+  uint8_t status;
+
+  PROCESS_BEGIN();
+  send_reset();
+  etimer_set(&retry, DTN_SINK_RETRY_TIME);
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+    if(rx_ready) {
+      ///Only an intact ack for our reset or the batch in flight counts
+      if(!synced && intact_ack()) {
+        PRINTF("--- [SINK] Collector in step, batches start at %d\n", batch_seq);
+        synced = 1;
+        etimer_stop(&retry);
+      } else if(synced && inflight > 0 && intact_ack()) {
+        status = rx_buf[2];
+        if(status == DTN_SINK_ACK_RESEND) {
+          send_batch();
+          etimer_set(&retry, DTN_SINK_RETRY_TIME);
+        } else {
+          ///The collector has the batch, now it is safe to free the bundles
+          while(inflight > 0) {
+            e = list_pop(sink_list);
+            memb_free(&sink_memb, e);
+            inflight--;
+          }
+          batch_seq++;
+          etimer_stop(&retry);
+          if(status == DTN_SINK_ACK_BUSY) {
+            etimer_set(&hold, DTN_SINK_HOLD_TIME);
+          }
+          if(sink_room != NULL) {
+            sink_room();
+          }
+        }
+      }
+      rx_ready = 0;
+    }
+
+    if(!synced) {
+      if(etimer_expired(&retry)) {
+        send_reset();
+        etimer_set(&retry, DTN_SINK_RETRY_TIME);
+      }
+    } else if(inflight > 0) {
+      if(etimer_expired(&retry)) {
+        PRINTF("--- [SINK] No ack for batch %d, resending\n", batch_seq);
+        send_batch();
+        etimer_set(&retry, DTN_SINK_RETRY_TIME);
+      }
+    } else if(list_length(sink_list) > 0 && etimer_expired(&hold)) {
+      ///Send a full batch straight away, otherwise give the batch a little time to fill
+      if(list_length(sink_list) >= DTN_SINK_BATCH || (ev == PROCESS_EVENT_TIMER && data == &flush)) {
+        inflight = list_length(sink_list) < DTN_SINK_BATCH ? list_length(sink_list) : DTN_SINK_BATCH;
+        send_batch();
+        etimer_set(&retry, DTN_SINK_RETRY_TIME);
+        etimer_stop(&flush);
+      } else if(etimer_expired(&flush)) {
+        etimer_set(&flush, DTN_SINK_FLUSH_TIME);
+      }
+    }
+  }
+  PROCESS_END();
+}
+#endif /* DTN_SINK */
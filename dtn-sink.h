@@ -0,0 +1,93 @@
+/**
+ * @file dtn-sink.h
+ * @author Archie Norman
+ * @brief Sink mode, bundles delivered to this node are queued and sent in
+ * batches over SLIP to tools/dtn-collector.c on the host. A bundle is only
+ * freed once the collector has acknowledged the batch it went out in, and
+ * when the queue is full the bundle stays in the message cache until there
+ * is room again. Enable with DTN_CONF_SINK in project-conf.h.
+ *
+ * Frames before SLIP encoding, all fields little endian:
+ *
+ *   batch: 'D' | batch seq | count | count records | crc16
+ *   record: from | src | dest | seq | copies | timestamp (4) | len | len bytes of msg
+ *   reset: 'R' | batch seq | crc16
+ *   ack:   'A' | batch seq | status | crc16
+ *
+ * After boot the sink sends a reset until the collector acks it. The batch
+ * seq starts again from 0, the collector forgets the last one it stored so
+ * the first batches are not taken for repeats of the last session's.
+ * The crc16 is Contiki's crc16_data() over everything before it, which lets
+ * the collector skip debug text that shares the uart with the frames.
+ */
+#ifndef __DTN_SINK_H__
+#define __DTN_SINK_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_SINK
+#define DTN_SINK DTN_CONF_SINK
+#else
+#define DTN_SINK 0
+#endif
+///Delivered bundles waiting for the collector
+#ifdef DTN_CONF_SINK_QUEUE
+#define DTN_SINK_QUEUE DTN_CONF_SINK_QUEUE
+#else
+#define DTN_SINK_QUEUE 8
+#endif
+///Bundles sent in one SLIP frame
+#ifdef DTN_CONF_SINK_BATCH
+#define DTN_SINK_BATCH DTN_CONF_SINK_BATCH
+#else
+#define DTN_SINK_BATCH 4
+#endif
+///How long a part filled batch waits for more bundles before it is sent anyway
+#ifdef DTN_CONF_SINK_FLUSH_TIME
+#define DTN_SINK_FLUSH_TIME DTN_CONF_SINK_FLUSH_TIME
+#else
+#define DTN_SINK_FLUSH_TIME (CLOCK_SECOND / 4)
+#endif
+///How long to wait for an ack before the batch is sent again
+#ifdef DTN_CONF_SINK_RETRY_TIME
+#define DTN_SINK_RETRY_TIME DTN_CONF_SINK_RETRY_TIME
+#else
+#define DTN_SINK_RETRY_TIME CLOCK_SECOND
+#endif
+///How long to hold off after the collector says it is busy
+#ifdef DTN_CONF_SINK_HOLD_TIME
+#define DTN_SINK_HOLD_TIME DTN_CONF_SINK_HOLD_TIME
+#else
+#define DTN_SINK_HOLD_TIME (CLOCK_SECOND * 5)
+#endif
+///Where the SLIP bytes go and come from, uart1 on the mc1322x
+#ifndef DTN_SINK_CONF_WRITEB
+#define DTN_SINK_CONF_WRITEB(c) slip_arch_writeb(c)
+#endif
+#ifndef DTN_SINK_CONF_SET_INPUT
+#define DTN_SINK_CONF_SET_INPUT(f) uart1_set_input(f)
+#endif
+
+#define DTN_SINK_FRAME_BATCH 'D'
+#define DTN_SINK_FRAME_ACK   'A'
+#define DTN_SINK_FRAME_RESET 'R'
+///Status carried in an ack
+enum
+{
+	DTN_SINK_ACK_OK = 0,     ///<Batch stored, send the next one
+	DTN_SINK_ACK_BUSY = 1,   ///<Batch stored, hold off for DTN_SINK_HOLD_TIME
+	DTN_SINK_ACK_RESEND = 2  ///<Batch was damaged, send it again
+};
+/*
+ * @brief Start the sink process and take over the uart input
+ * @param1 - called whenever queue space is freed, so held bundles can be offered again
+ */
+void dtn_sink_init(void (* room)(void));
+/*
+ * @brief Queue a delivered bundle for the collector
+ * @param1 - the bundle
+ * @param2 - the neighbour it was received from
+ * @return 1 if the sink took the bundle, 0 if the queue is full
+ */
+int dtn_sink_deliver(const dtn_message *message, const rimeaddr_t *from);
+
+#endif /* __DTN_SINK_H__ */
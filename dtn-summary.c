@@ -0,0 +1,86 @@
+/**
+ * @file dtn-summary.c
+ * @author Archie Norman
+ * @brief Per neighbour hashes of the last summary vector that needed nothing.
+ */
+#include "dtn-summary.h"
+#include "lib/crc16.h"
+#include <stdio.h>
+
+#if DTN_SUMMARY_CACHE
+static struct
+{
+	rimeaddr_t addr;
+	uint16_t hash;
+	uint16_t version;
+	struct timer heard;
+}neighbours[DTN_SUMMARY_NEIGHBOURS];
+///Hash of the summary last checked, kept for dtn_summary_idle()
+static uint16_t checked;
+/*
+ * @brief Hash the parts of a summary vector that decide what we send,
+ * the time fields change every beacon and are left out
+ */
+static uint16_t
+hash(const dtn_summary_vector *summary)
+{
+  uint16_t h;
+  h = crc16_add(summary->header.len, 0);
+  h = crc16_add(summary->flags, h);
+  h = crc16_add(summary->free_slots, h);
+  return crc16_data((const unsigned char *)summary->message_ids,
+    summary->header.len * sizeof(dtn_msg_id), h);
+}
+/*
+ * @brief Find a neighbour's entry
+ */
+static int
+find(const rimeaddr_t *addr)
+{
+  int i;
+  for(i = 0; i < DTN_SUMMARY_NEIGHBOURS; i++) {
+    if(rimeaddr_cmp(&neighbours[i].addr, addr) && !timer_expired(&neighbours[i].heard)) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+dtn_summary_unchanged(const rimeaddr_t *from, const dtn_summary_vector *summary, uint16_t version)
+{
+  int i;
+  checked = hash(summary);
+  i = find(from);
+  if(i < 0 || neighbours[i].hash != checked || neighbours[i].version != version) {
+    return 0;
+  }
+  PRINTF("--- [SUMMARY] %d.%d unchanged, nothing to send\n", from->u8[0], from->u8[1]);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_summary_idle(const rimeaddr_t *from, uint16_t version)
+{
+  int i, oldest;
+  i = find(from);
+  if(i < 0) {
+    ///A free or expired slot, otherwise the one closest to expiring
+    for(i = 0, oldest = 0; i < DTN_SUMMARY_NEIGHBOURS; i++) {
+      if(timer_expired(&neighbours[i].heard)) {
+        break;
+      }
+      if(timer_remaining(&neighbours[i].heard) < timer_remaining(&neighbours[oldest].heard)) {
+        oldest = i;
+      }
+    }
+    if(i == DTN_SUMMARY_NEIGHBOURS) {
+      i = oldest;
+    }
+    rimeaddr_copy(&neighbours[i].addr, from);
+  }
+  neighbours[i].hash = checked;
+  neighbours[i].version = version;
+  timer_set(&neighbours[i].heard, DTN_SUMMARY_LIFETIME);
+}
+#endif /* DTN_SUMMARY_CACHE */
@@ -0,0 +1,50 @@
+/**
+ * @file dtn-summary.h
+ * @author Archie Norman
+ * @brief Receiver side summary cache. In a stable cluster the same neighbours
+ * keep beaconing the same summary vector, and each one is compared against
+ * the whole cache only to find there is nothing to send. For each neighbour
+ * we keep a short hash of the last summary that needed nothing and the
+ * version of our cache at the time, a beacon that matches both is answered
+ * without walking the cache. The cache version is bumped by dtn.c whenever a
+ * bundle is added, removed or has its copies changed, entries also expire
+ * so time dependent decisions (dtn-plan.h) are revisited. Enable with
+ * DTN_CONF_SUMMARY_CACHE in project-conf.h.
+ */
+#ifndef __DTN_SUMMARY_H__
+#define __DTN_SUMMARY_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_SUMMARY_CACHE
+#define DTN_SUMMARY_CACHE DTN_CONF_SUMMARY_CACHE
+#else
+#define DTN_SUMMARY_CACHE 0
+#endif
+///Neighbours whose last idle summary is remembered
+#ifdef DTN_SUMMARY_CONF_NEIGHBOURS
+#define DTN_SUMMARY_NEIGHBOURS DTN_SUMMARY_CONF_NEIGHBOURS
+#else
+#define DTN_SUMMARY_NEIGHBOURS 8
+#endif
+///How long a remembered summary is trusted
+#ifdef DTN_SUMMARY_CONF_LIFETIME
+#define DTN_SUMMARY_LIFETIME DTN_SUMMARY_CONF_LIFETIME
+#else
+#define DTN_SUMMARY_LIFETIME (CLOCK_SECOND * 60)
+#endif
+/*
+ * @brief Check a beacon against the neighbour's last idle summary
+ * @param1 - the neighbour
+ * @param2 - its summary vector
+ * @param3 - the version of our cache
+ * @return 1 if neither changed, so there is nothing to send
+ */
+int dtn_summary_unchanged(const rimeaddr_t *from, const dtn_summary_vector *summary, uint16_t version);
+/*
+ * @brief Remember that the summary just checked needed nothing from us
+ * @param1 - the neighbour
+ * @param2 - the version of our cache
+ */
+void dtn_summary_idle(const rimeaddr_t *from, uint16_t version);
+
+#endif /* __DTN_SUMMARY_H__ */
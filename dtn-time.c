@@ -0,0 +1,73 @@
+/**
+ * @file dtn-time.c
+ * @author Archie Norman
+ * @brief Network time from the offsets piggybacked on beacons.
+ */
+#include "dtn-time.h"
+#include <stdio.h>
+
+#if DTN_TIMESYNC
+///Added to clock_seconds() to get the network time
+static int32_t offset;
+#if DTN_TIME_ROOT
+static uint8_t level = 0;
+#else
+static uint8_t level = DTN_TIME_UNSYNCED;
+#endif
+///The neighbour we follow and when we last heard it
+static rimeaddr_t parent;
+static struct timer refresh;
+///The level we lost and the hold down that started then
+static uint8_t lost_level;
+static struct timer holddown;
+/*---------------------------------------------------------------------------*/
+uint32_t
+dtn_time_now(void)
+{
+  return (uint32_t)clock_seconds() + offset;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+dtn_time_level(void)
+{
+#if !DTN_TIME_ROOT
+  if(level != DTN_TIME_UNSYNCED && timer_expired(&refresh)) {
+    PRINTF("--- [TIME] Lost level %d, unsynchronised\n", level);
+    lost_level = level;
+    timer_set(&holddown, DTN_TIME_HOLDDOWN);
+    level = DTN_TIME_UNSYNCED;
+  }
+#endif
+  return level;
+}
+/*---------------------------------------------------------------------------*/
+void
+dtn_time_beacon(const rimeaddr_t *from, uint32_t time, uint8_t level_heard)
+{
+  int32_t new_offset;
+  if(level_heard == DTN_TIME_UNSYNCED || level_heard >= DTN_TIME_MAX_LEVEL) {
+    return;
+  }
+  ///Nodes that followed us may still beacon the level they had through us
+  if(dtn_time_level() == DTN_TIME_UNSYNCED && !timer_expired(&holddown) && level_heard >= lost_level) {
+    return;
+  }
+  ///Take a lower level from anyone, the same level only from the one we follow
+  if(level_heard + 1 < dtn_time_level() ||
+     (level_heard + 1 == level && rimeaddr_cmp(from, &parent))) {
+    new_offset = (int32_t)(time - (uint32_t)clock_seconds());
+    ///A second either way is just where the two clocks tick over, not drift
+    if(level == level_heard + 1 && new_offset - offset <= 1 && offset - new_offset <= 1) {
+      new_offset = offset;
+    }
+    if(new_offset != offset || level != level_heard + 1) {
+      PRINTF("--- [TIME] Following %d.%d level %d, offset %ld\n",
+        from->u8[0], from->u8[1], level_heard + 1, (long)new_offset);
+    }
+    offset = new_offset;
+    level = level_heard + 1;
+    rimeaddr_copy(&parent, from);
+    timer_set(&refresh, DTN_TIME_TIMEOUT);
+  }
+}
+#endif /* DTN_TIMESYNC */
@@ -0,0 +1,76 @@
+/**
+ * @file dtn-time.h
+ * @author Archie Norman
+ * @brief Network time. Every beacon carries the sender's network time in
+ * seconds and its level, the number of hops to the time root (level 0, set
+ * with DTN_TIME_CONF_ROOT). A node follows the lowest level it hears and
+ * keeps an offset from its own clock_seconds(), so bundle timestamps and the
+ * [MSG-CRT]/[RCV-RCH] records from different nodes can be compared. A node
+ * that has not heard its level for DTN_TIME_TIMEOUT drops back to
+ * unsynchronised. For DTN_TIME_HOLDDOWN after that it only follows a node
+ * closer to the root than it was, so it does not take back the stale level
+ * of a node that followed it, then it follows whoever it hears. Enable with
+ * DTN_CONF_TIMESYNC in project-conf.h, without it dtn_time_now() is just
+ * clock_seconds().
+ */
+#ifndef __DTN_TIME_H__
+#define __DTN_TIME_H__
+#include "dtn.h"
+
+#ifdef DTN_CONF_TIMESYNC
+#define DTN_TIMESYNC DTN_CONF_TIMESYNC
+#else
+#define DTN_TIMESYNC 0
+#endif
+///Whether this node is the time root, the collector is the natural choice
+#ifdef DTN_TIME_CONF_ROOT
+#define DTN_TIME_ROOT DTN_TIME_CONF_ROOT
+#else
+#define DTN_TIME_ROOT 0
+#endif
+///How long a level is trusted without hearing it again
+#ifdef DTN_TIME_CONF_TIMEOUT
+#define DTN_TIME_TIMEOUT DTN_TIME_CONF_TIMEOUT
+#else
+#define DTN_TIME_TIMEOUT (CLOCK_SECOND * 120)
+#endif
+///How long a node that lost its level only follows one closer to the root than it was
+#ifdef DTN_TIME_CONF_HOLDDOWN
+#define DTN_TIME_HOLDDOWN DTN_TIME_CONF_HOLDDOWN
+#else
+#define DTN_TIME_HOLDDOWN DTN_TIME_TIMEOUT
+#endif
+///Level of a node that is not synchronised to anyone
+#define DTN_TIME_UNSYNCED 0xff
+///Deepest level followed, a loop that counts up stops here rather than wrapping in to DTN_TIME_UNSYNCED
+#ifdef DTN_TIME_CONF_MAX_LEVEL
+#define DTN_TIME_MAX_LEVEL DTN_TIME_CONF_MAX_LEVEL
+#else
+#define DTN_TIME_MAX_LEVEL 32
+#endif
+#if DTN_TIME_MAX_LEVEL >= DTN_TIME_UNSYNCED
+#error "DTN_TIME_MAX_LEVEL has to stay below DTN_TIME_UNSYNCED"
+#endif
+
+#if DTN_TIMESYNC
+/*
+ * @brief The network time in seconds
+ */
+uint32_t dtn_time_now(void);
+/*
+ * @brief Our level, DTN_TIME_UNSYNCED until we have heard a synchronised node
+ */
+uint8_t dtn_time_level(void);
+/*
+ * @brief Follow a neighbour's time if it is closer to the root than we are
+ * @param1 - the neighbour
+ * @param2 - its network time
+ * @param3 - its level
+ */
+void dtn_time_beacon(const rimeaddr_t *from, uint32_t time, uint8_t level);
+#else
+#define dtn_time_now() ((uint32_t)clock_seconds())
+#define dtn_time_level() DTN_TIME_UNSYNCED
+#endif
+
+#endif /* __DTN_TIME_H__ */
@@ -8,46 +8,334 @@
 * the best-effort and reliable communication abstractions.
 */
 #include "dtn.h"
+#include "dtn-capture.h"
+#include "dtn-replay.h"
+#include "dtn-bench.h"
+#include "dtn-sink.h"
+#include "dtn-group.h"
+#include "dtn-custody.h"
+#include "dtn-backpressure.h"
+#include "dtn-time.h"
+#include "dtn-announce.h"
+#include "dtn-coding.h"
+#include "dtn-adapt.h"
+#include "dtn-sim.h"
+#include "dtn-plan.h"
+#include "dtn-duty.h"
+#include "dtn-sample.h"
+#include "dtn-summary.h"
+#include "dtn-route.h"
+#include "dtn-link.h"
+#include "dtn-overhear.h"
+#include "dtn-api.h"
+#include "dtn-multicast.h"
+#include "dtn-freq.h"
 #include "utilities.c"
 #include "contiki.h"
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "lib/random.h"
 #include "net/rime.h"
+#if !DTN_REPLAY && !DTN_BENCH && !DTN_SIM
 #include "button-sensors.h"
+#endif
 #include "lib/sensors.h"
 #include "hmc5883l.h"
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #define FLASH_LED(l) {leds_on(l); clock_delay_msec(50); leds_off(l); clock_delay(50);}
 #define MAX_RETRANSMISSIONS 4
 ///Define the global structures
 static struct broadcast_conn broadcast;
 static struct runicast_conn runicast;
-static struct etimer et;
-static clock_time_t current_time;
 ///Glboal variables to store transmission metrics
 int acks;
 int timeouts;
 int total_unicast_sent;
+int total_allocs;
+///Bundles popped from a full cache since our last beacon
+static int evicted;
+///Bumped whenever a bundle is added, removed or has its copies changed (dtn-summary.h)
+static uint16_t cache_version;
 ///The was used to extract message summary information.
 static void
-print_msg_id(dtn_msg_id *id)
+print_msg_id(const dtn_msg_id *id)
 {
  printf("<%d.%d:%d.%d:%d>",
    id->src.u8[0], id->src.u8[1],
    id->dest.u8[0], id->dest.u8[1],
    id->seq);
 }
+///The message ids in the runicast packet in flight and who it went to
+static dtn_msg_id sent_ids[DTN_VECTOR_MESSAGES];
+static int sent_len;
+static rimeaddr_t sent_to;
+#if DTN_PLAN
+///Which of them went whole to the next hop on the plan, decided when the packet went out
+static uint8_t sent_planned[DTN_VECTOR_MESSAGES];
+#endif
+/*
+ * @brief Finds a message in the packet just acknowledged
+ * @param1 - the message id
+ * @param2 - the neighbour that acknowledged the packet
+ * @return its place in the packet, -1 if it was not in it
+ */
+static int find_sent(const dtn_msg_id *id, const rimeaddr_t *to)
+{
+  int i;
+  if(!rimeaddr_cmp(&sent_to, to)) {
+    return -1;
+  }
+  for(i = 0; i < sent_len; i++) {
+    if(rimeaddr_cmp(&sent_ids[i].src, &id->src) && rimeaddr_cmp(&sent_ids[i].dest, &id->dest) &&
+       sent_ids[i].seq == id->seq) {
+      return i;
+    }
+  }
+  return -1;
+}
+#if DTN_GROUPS
+/*
+ * @brief Checks if a message was in the packet just acknowledged
+ * @param1 - the message id
+ * @param2 - the neighbour that acknowledged the packet
+ */
+static int was_sent(const dtn_msg_id *id, const rimeaddr_t *to)
+{
+  return find_sent(id, to) >= 0;
+}
+#endif
 ///This MEMB() definition defines a memory pool from which we allocate message entries.
 MEMB(messages_memb, dtn_vector_list, MAX_MESSAGES);
+///The cache has to fit the target's RAM budget, raise DTN_CONF_CACHE_RAM or lower DTN_CONF_MAX_MESSAGES
+DTN_STATIC_ASSERT(MAX_MESSAGES > 0 && MAX_MESSAGES * (sizeof(dtn_vector_list) + 1) <= DTN_CACHE_RAM, cache_fits_ram);
+///The packed sizes MAX_MESSAGES and MAX_MSG_VECTORS were worked out with
+DTN_STATIC_ASSERT(sizeof(dtn_msg_id) == DTN_MSG_ID_SIZE && sizeof(dtn_message) == DTN_MESSAGE_SIZE, packed_sizes);
+DTN_STATIC_ASSERT(sizeof(dtn_summary_vector) <= PACKETBUF_SIZE, summary_fits_frame);
+///Every node puts the same header on the air, DTN_SUMMARY_ROOM counts on 13 bytes before the ids
+DTN_STATIC_ASSERT(sizeof(dtn_header) == 2 && offsetof(dtn_summary_vector, message_ids) == 13, header_layout);
+///Beacons and bundles from frames are built here in turn
+static dtn_frame_scratch scratch;
 ///The neighbors_list is a Contiki list that holds the messages we have seen thus far.
 LIST(messages_list);
 ///Delcare the prorcess used.
 PROCESS(broadcast_process, "Broadcast process");
-PROCESS(button_actions, "Buttons process");
 ///The AUTOSTART_PROCESSES() definition specifices what processes to start when this module is loaded. We put both our processes there.
+#if DTN_REPLAY || DTN_BENCH || DTN_SIM
+///Replays, benchmarks and the simulator inject their own bundles, so the buttons are left out
+AUTOSTART_PROCESSES(&broadcast_process);
+#else
+PROCESS(button_actions, "Buttons process");
 AUTOSTART_PROCESSES(&broadcast_process, &button_actions);
+#endif
+/*
+ * @brief Decides if a bundle a neighbour is missing gets sprayed to it
+ * @param1 - the bundle in our cache
+ * @param2 - the neighbour
+ * @param3 - where to write the copy to send, with its share of the copies
+ * @return 1 if the bundle should be sent
+ */
+static int spray_copy(const dtn_message *message, const rimeaddr_t *to, dtn_message *out)
+{
+#if DTN_GROUPS
+  uint8_t member;
+#endif
+#if DTN_PLAN
+  rimeaddr_t hop;
+#endif
+#if DTN_SINK
+  ///Bundles held for the collector have already arrived, they are not sprayed any further
+  if(rimeaddr_cmp(&message->hdr.message_id.dest, &rimeaddr_node_addr)) {
+    return 0;
+  }
+#endif
+#if DTN_PLAN
+  ///Bundles the plan reaches go whole to the next hop on the route, or straight to the destination
+  if(dtn_plan_next_hop(&message->hdr.message_id.dest, &hop)) {
+    if(!rimeaddr_cmp(to, &hop) && !rimeaddr_cmp(to, &message->hdr.message_id.dest)) {
+      return 0;
+    }
+    *out = *message;
+    return 1;
+  }
+#endif
+#if DTN_GROUPS
+  if(dtn_group_is_group(&message->hdr.message_id.dest)) {
+    member = dtn_group_member_bit(&message->hdr.message_id.dest, to) & ~message->hdr.reserved;
+    ///A member still waiting always gets it, anyone else only while there are copies to split
+    if(!member && message->hdr.number_of_copies <= 1) {
+      return 0;
+    }
+    *out = *message;
+    out->hdr.reserved |= member;
+    ///Split the copies as usual, from the last copy a member only gets a delivery copy it will not forward
+    if (out->hdr.number_of_copies > 1) {
+      out->hdr.number_of_copies /= 2;
+    }
+    else {
+      out->hdr.number_of_copies = 0;
+    }
+    return 1;
+  }
+#endif
+  ///Everything else is up to the routing strategy (dtn-route.h)
+  if(!dtn_route.should_forward(message, to)) {
+    PRINTF("--- [ALERT] This neighbour does not have this message, but %s does not forward it\n", dtn_route.name);
+    return 0;
+  }
+  ///Add the message in my cache to the unicast message so its ready for sending
+  *out = *message;
+  out->hdr.number_of_copies = dtn_route.hand_over(message, to);
+  return 1;
+}
+///The bundles picked for a neighbour
+static dtn_vector unicast_message;
+#if DTN_OVERHEAR
+///Who the transfer held back in unicast_message is for
+static rimeaddr_t held_to;
+#endif
+/*
+ * @brief Sends the bundles in unicast_message, unless runicast is still busy
+ * with the last packet
+ * @param1 - the neighbour
+ */
+static void transmit(const rimeaddr_t *to)
+{
+  int d;
+#if DTN_PLAN
+  rimeaddr_t hop;
+#endif
+  ///Make sure that the buffer is not already being used by runicast
+  if(!runicast_is_transmitting(&runicast)) {
+    ///Sanity check, print each message in the uniacst packet
+    for (d = 0; d < unicast_message.header.len; d++) {
+    PRINTF("--- [S-UC] Src: %d.%d | Dest %d.%d | Seq: %d | Copies %d | Timestamp %d | Len: %d  ---- \n",
+      unicast_message.message[d].hdr.message_id.src.u8[0], unicast_message.message[d].hdr.message_id.src.u8[1],
+      unicast_message.message[d].hdr.message_id.dest.u8[0], unicast_message.message[d].hdr.message_id.dest.u8[1],
+      unicast_message.message[d].hdr.message_id.seq,
+      unicast_message.message[d].hdr.number_of_copies,
+      unicast_message.message[d].hdr.timestamp,
+      unicast_message.header.len
+      );
+    }
+    ///Remember what went in this packet for when it is acknowledged
+    for (d = 0; d < unicast_message.header.len; d++) {
+      sent_ids[d] = unicast_message.message[d].hdr.message_id;
+#if DTN_PLAN
+      sent_planned[d] = dtn_plan_next_hop(&sent_ids[d].dest, &hop) && rimeaddr_cmp(&hop, to);
+#endif
+    }
+    sent_len = unicast_message.header.len;
+    rimeaddr_copy(&sent_to, to);
+#if DTN_DUTY
+    ///Stay awake for the acknowledgement and whatever the neighbour sends back
+    dtn_duty_hold();
+#endif
+    ///Copy the runicast message in to the packet buffer
+    packetbuf_copyfrom(&unicast_message, sizeof(dtn_vector));
+    ///Assign a maximum retransmuission and send
+#if DTN_LINK
+    runicast_send(&runicast, to, dtn_link_retransmissions(to));
+#else
+    runicast_send(&runicast, to, MAX_RETRANSMISSIONS);
+#endif
+    ///Increment for testing purposes
+    total_unicast_sent ++;
+  }
+}
+#if DTN_FREQ
+/*
+ * @brief Both ends are on the data frequency, send what was held in unicast_message
+ * @param1 - the neighbour
+ */
+static int freq_send(const rimeaddr_t *to)
+{
+  if(runicast_is_transmitting(&runicast)) {
+    return 0;
+  }
+  transmit(to);
+  return 1;
+}
+#endif
+/*
+ * @brief Starts the transfer in unicast_message, once the neighbour has
+ * moved to a data frequency with us if they are separated
+ * @param1 - the neighbour
+ */
+static void send_unicast(const rimeaddr_t *to)
+{
+#if DTN_FREQ
+  ///unicast_message is kept until the neighbour answers or the request times out
+  if(!runicast_is_transmitting(&runicast)) {
+    dtn_freq_request(to);
+  }
+#else
+  transmit(to);
+#endif
+}
+#if DTN_OVERHEAR
+/*
+ * @brief Another neighbour was heard sending a bundle, if it is one we were
+ * about to send to the same node it is dropped from our transfer
+ * @param1 - the node it went to
+ * @param2 - the message id
+ */
+static void overheard(const rimeaddr_t *to, const dtn_msg_id *id)
+{
+  int d;
+#if DTN_CODING
+  ///Until its next beacon the node is not picked for a coded frame carrying this bundle
+  dtn_coding_heard(to, id);
+#endif
+  if(!dtn_overhear_pending() || !rimeaddr_cmp(to, &held_to)) {
+    return;
+  }
+  for (d = 0; d < unicast_message.header.len; d++) {
+    if(rimeaddr_cmp(&unicast_message.message[d].hdr.message_id.src, &id->src) &&
+       rimeaddr_cmp(&unicast_message.message[d].hdr.message_id.dest, &id->dest) &&
+       unicast_message.message[d].hdr.message_id.seq == id->seq) {
+      PRINTF("--- [OVERHEAR] %d.%d already getting <%d.%d:%d>\n", to->u8[0], to->u8[1],
+        id->src.u8[0], id->src.u8[1], id->seq);
+      memmove(&unicast_message.message[d], &unicast_message.message[d + 1],
+        (unicast_message.header.len - d - 1) * sizeof(dtn_message));
+      unicast_message.header.len--;
+      break;
+    }
+  }
+  if(unicast_message.header.len == 0) {
+    dtn_overhear_cancel();
+  }
+}
+/*
+ * @brief The hold-off is over and some of the transfer is left
+ */
+static void held_send(void)
+{
+  send_unicast(&held_to);
+}
+#endif
+/*
+ * @brief Clamps the count in a received frame to the entries that actually
+ * arrived, so a short or corrupt frame cannot walk the loops off the end of
+ * the packet buffer
+ * @param1 - the header at the start of the packet buffer
+ * @param2 - the bytes before the first entry
+ * @param3 - the size of one entry
+ * @return the entries to read, -1 if the frame is too short to hold its header
+ */
+static int received_len(dtn_header *header, uint16_t fixed, uint16_t entry)
+{
+  uint16_t fits;
+  if(packetbuf_datalen() < fixed) {
+    return -1;
+  }
+  fits = (packetbuf_datalen() - fixed) / entry;
+  if(header->len > fits) {
+    header->len = fits;
+  }
+  return header->len;
+}
 /*
  *@param1 - Broadcast receive function takes a pointer to the delared broadcast connetion struct
  *@param2 - from address as parareters.
@@ -63,25 +351,82 @@ static void broadcast_recv(struct broadcast_conn *c, const rimeaddr_t *from)
    */
   dtn_summary_vector *broadcast_received;
   dtn_vector_list *tmp;
-  static dtn_vector unicast_message;
+#if DTN_MULTICAST
+  uint8_t owed;
+#endif
   ///Returns a pointer to the data in the packet buffer and assign it to broadcast receive
   broadcast_received = packetbuf_dataptr();
-  int flag, i, b, a, d;
+  int i, b;
   b = 0;
+#if DTN_CAPTURE
+  dtn_capture_frame(DTN_CAPTURE_BROADCAST, from, 0);
+#endif
+  ///Everything below, the modules included, reads no more ids than arrived
+  if(received_len(&broadcast_received->header, offsetof(dtn_summary_vector, message_ids), sizeof(dtn_msg_id)) < 0) {
+    return;
+  }
   ///Sanity check to mkae sure the data we receive is correct
-  printf("--- [R-BC] From: %d.%d *** \n",
+  PRINTF("--- [R-BC] From: %d.%d *** \n",
     from->u8[0], from->u8[1]
     // broadcast_received->message_ids[i].src.u8[0], broadcast_received->message_ids[i].src.u8[1],
     // broadcast_received->message_ids[i].dest.u8[0], broadcast_received->message_ids[i].dest.u8[1],
     // broadcast_received->message_ids[i].seq
     );
+#if DTN_CUSTODY
+  ///Remember if the neighbour will take custody
+  dtn_custody_beacon(from, broadcast_received->flags);
+#endif
+#if DTN_TIMESYNC
+  dtn_time_beacon(from, broadcast_received->time, broadcast_received->time_level);
+#endif
+#if DTN_ADAPT
+  ///Counts towards the network size and encounter rate estimates
+  dtn_adapt_beacon(from);
+#endif
+#if DTN_DUTY
+  ///Learn when the neighbour is awake
+  dtn_duty_beacon(from, broadcast_received->wake_phase);
+#endif
+#if DTN_CODING
+  ///Kept to find bundles that can be xored together for two neighbours
+  dtn_coding_beacon(from, broadcast_received);
+#endif
+#if DTN_MULTICAST
+  ///Shares from our frames the neighbour now holds are settled
+  dtn_multicast_summary(from, broadcast_received);
+#endif
+#if DTN_SUMMARY_CACHE
+  ///Same summary as last time and nothing changed here, so still nothing to send
+  if(dtn_summary_unchanged(from, broadcast_received, cache_version)) {
+    return;
+  }
+#endif
+#if DTN_LINK
+  ///A neighbour we just failed to reach is left alone for a while
+  if(!dtn_link_usable(from)) {
+    return;
+  }
+#endif
+#if DTN_OVERHEAR
+  ///unicast_message is taken by a transfer waiting to go
+  if(dtn_overhear_pending()) {
+    return;
+  }
+#endif
+#if DTN_FREQ
+  ///unicast_message is taken by a transfer waiting for its neighbour to answer
+  if(dtn_freq_busy()) {
+    return;
+  }
+#endif
   /*
    *Assign the first element in the messages cache to
    *tmp and iterate through each element.
    *At each iteration we must then iterate through each
    *of the summary vector elements
    */
-  for(tmp = list_head(messages_list); tmp != NULL; tmp = list_item_next(tmp)) {
+  ///Larger payloads mean fewer bundles fit in a runicast frame
+  for(tmp = list_head(messages_list); tmp != NULL && b < DTN_VECTOR_MESSAGES; tmp = list_item_next(tmp)) {
     for (i = 0; i < broadcast_received->header.len; i++) {
       ///Check to see which messages the neighbour already has
       if ((rimeaddr_cmp(&broadcast_received->message_ids[i].src, &tmp->message.hdr.message_id.src) &&
@@ -97,108 +442,249 @@ static void broadcast_recv(struct broadcast_conn *c, const rimeaddr_t *from)
         break;
       }
     }
-    if(i == broadcast_received->header.len) {
-      ///Check to see if the there is only one copy left of this message
-      if(tmp->message.hdr.number_of_copies == 1) {
-        /// Only one left, check to see if they are the destination address
-        if(!rimeaddr_cmp(&tmp->message.hdr.message_id.dest, from)) {
-          printf("--- [ALERT] This neighbour does not have this message, but they are not the destination and there is only one copy left\n");
-          continue;
-        }
-      }
-      ///Add the message in my cache to the unicast message so its ready for sending
+    if(i < broadcast_received->header.len) {
+      continue;
+    }
+#if DTN_MULTICAST
+    ///Still missing a share from one of our frames, it gets that share again
+    if(dtn_multicast_owed(from, &tmp->message.hdr.message_id, &owed)) {
       unicast_message.message[b] = tmp->message;
-      ///Make sure we are not sending a 0 value for the number of copies remaining.
-      if (unicast_message.message[b].hdr.number_of_copies != 1) {
-        ///Halve the number of copies before sending
-        unicast_message.message[b].hdr.number_of_copies /= 2;
-      }
+      unicast_message.message[b++].hdr.number_of_copies = owed;
+      continue;
+    }
+#endif
+    if(spray_copy(&tmp->message, from, &unicast_message.message[b])) {
       b++;
     }
   }
+#if DTN_BACKPRESSURE
+  ///Only send what the neighbour can hold without popping anything
+  b = dtn_backpressure_trim(unicast_message.message, b, from, broadcast_received);
+#endif
+#if DTN_SUMMARY_CACHE
+  if(b == 0) {
+    dtn_summary_idle(from, cache_version);
+  }
+#endif
+#if DTN_MULTICAST
+  ///Held for the window in case other neighbours are missing the same bundles, repairs go now
+  b = dtn_multicast_offer(from, unicast_message.message, b);
+#endif
+#if DTN_CODING
+  ///Sends one of them xored with a bundle another neighbour is missing if it can
+  if(b > 0 && !runicast_is_transmitting(&runicast)) {
+    b = dtn_coding_pair(from, unicast_message.message, b);
+  }
+#endif
   if(b == 0) {
     return;
   }
   ///Set the message type and the len of the packet
   unicast_message.header.type = DTN_MESSAGE;
   unicast_message.header.len = b;
-  ///Make sure that the buffer is not already being used by runicast
-  if(!runicast_is_transmitting(&runicast)) {
-    ///Sanity check, print each message in the uniacst packet
-    for (d = 0; d < unicast_message.header.len; d++) {
-    printf("--- [S-UC] Src: %d.%d | Dest %d.%d | Seq: %d | Copies %d | Timestamp %d | Len: %d  ---- \n",
-      unicast_message.message[d].hdr.message_id.src.u8[0], unicast_message.message[d].hdr.message_id.src.u8[1],
-      unicast_message.message[d].hdr.message_id.dest.u8[0], unicast_message.message[d].hdr.message_id.dest.u8[1],
-      unicast_message.message[d].hdr.message_id.seq,
-      unicast_message.message[d].hdr.number_of_copies,
-      unicast_message.message[d].hdr.timestamp,
-      unicast_message.header.len
-      );
-    }
-    ///Copy the runicast message in to the packet buffer
-    packetbuf_copyfrom(&unicast_message, sizeof(dtn_vector));
-    ///Assign a maximum retransmuission and send
-    runicast_send(&runicast, from, MAX_RETRANSMISSIONS);
-    ///Increment for testing purposes
-    total_unicast_sent ++;
-  }
+#if DTN_OVERHEAR
+  ///Wait a moment in case another neighbour is already sending these
+  rimeaddr_copy(&held_to, from);
+#if DTN_DUTY
+  dtn_duty_hold();
+#endif
+  dtn_overhear_hold();
+#else
+  send_unicast(from);
+#endif
 }
 /*
  *This is where we define what function to be called when a broadcast is received.
  *We pass a pointer to this structure in the broadcast_open() call below.
  */
-static const struct broadcast_callbacks broadcast_call = {broadcast_recv};
+static const struct broadcast_callbacks broadcast_call = {broadcast_recv, NULL};
+/*
+ * @brief Looks a bundle up in the cache
+ * @param1 - the message id
+ * @return the cache entry, NULL if we do not hold it
+ */
+static dtn_vector_list *find_in_cache(const dtn_msg_id *id)
+{
+  dtn_vector_list *tmp;
+  for(tmp = list_head(messages_list); tmp != NULL; tmp = list_item_next(tmp)) {
+    if(rimeaddr_cmp(&tmp->message.hdr.message_id.src, &id->src) &&
+       rimeaddr_cmp(&tmp->message.hdr.message_id.dest, &id->dest) &&
+       tmp->message.hdr.message_id.seq == id->seq) {
+      return tmp;
+    }
+  }
+  return NULL;
+}
+#if DTN_CUSTODY
+///Slots kept free for bundles we answered a custody offer for and have not taken yet
+static uint8_t custody_held;
+#endif
+/*
+ * @brief The bundles the cache can take before it has to pop one
+ */
+static int cache_room(void)
+{
+#if DTN_CUSTODY
+  return MAX_MESSAGES - custody_held;
+#else
+  return MAX_MESSAGES;
+#endif
+}
+/*
+ * @brief Adds a message to the back of the cache, if the cache is full
+ * the oldest of the lowest priority messages is dropped to make room
+ * @param1 - the message to copy in to the cache
+ */
+static void add_to_cache(const dtn_message *message)
+{
+  dtn_vector_list *add_to_list, *tmp_head, *tmp;
+  cache_version++;
+  ///A second copy of a bundle we hold, e.g. from a neighbour with a stale summary, joins the first
+  tmp = find_in_cache(&message->hdr.message_id);
+  if(tmp != NULL) {
+    PRINTF("--- [ALERT] Already holding the bundle, merging the copies\n");
+    if(tmp->message.hdr.number_of_copies + message->hdr.number_of_copies > 255) {
+      tmp->message.hdr.number_of_copies = 255;
+    }
+    else {
+      tmp->message.hdr.number_of_copies += message->hdr.number_of_copies;
+    }
+    ///Group members served by either copy are served
+    tmp->message.hdr.reserved |= message->hdr.reserved;
+    return;
+  }
+  ///Check to see if there is space in the message cache, if so add it to the front.
+  if(list_length(messages_list) < cache_room()){
+    add_to_list = memb_alloc(&messages_memb);
+    total_allocs ++;
+    memcpy(&add_to_list->message, message, sizeof(dtn_message));
+    list_add(messages_list, add_to_list);
+  }
+  /*
+   *If there is not space, pop the oldest of the lowest priority, deallocate the memory,
+   *assign new memory and add the new message to the front
+   */
+  else {
+    PRINTF("--- [ALERT] Popping last element\n");
+    evicted ++;
+    tmp_head = list_head(messages_list);
+    for(tmp = list_item_next(tmp_head); tmp != NULL; tmp = list_item_next(tmp)) {
+      if(tmp->message.hdr.priority < tmp_head->message.hdr.priority) {
+        tmp_head = tmp;
+      }
+    }
+    ///Everything held matters more than the new one
+    if(message->hdr.priority < tmp_head->message.hdr.priority) {
+      dtn_api_expired(message);
+      return;
+    }
+    dtn_api_expired(&tmp_head->message);
+    list_remove(messages_list, tmp_head);
+    memb_free(&messages_memb, tmp_head);
+    add_to_list = memb_alloc(&messages_memb);
+    total_allocs ++;
+    memcpy(&add_to_list->message, message, sizeof(dtn_message));
+    list_add(messages_list, add_to_list);
+  }
+}
+/*
+ * @brief Consumes a message that has reached its destination
+ * @param1 - the message
+ * @param2 - the neighbour that gave it to us
+ * @return 0 if the sink could not take it yet, otherwise 1
+ */
+static int deliver_message(const dtn_message *message, const rimeaddr_t *from)
+{
+  PRINTF(" ********** Final desination reached **********\t --- Src: %d.%d | Dest: %d.%d | Copies: %d | Timestamp: %d | Msg *%s* ---\n",
+  message->hdr.message_id.src.u8[0], message->hdr.message_id.src.u8[1],
+  message->hdr.message_id.dest.u8[0], message->hdr.message_id.dest.u8[1],
+  message->hdr.number_of_copies, message->hdr.timestamp,
+  message->msg);
+  ///Pre-agreed format for testing purposes
+  printf("[RCV-RCH] ");
+  print_msg_id(&message->hdr.message_id);
+  printf(" from %d.%d", from->u8[0], from->u8[1]);
+  printf(" --%lu\n", (unsigned long)dtn_time_now());
+  ///Hand it to the application where it lies
+  dtn_api_receive(message, from);
+#if DTN_SIM
+  dtn_sim_delivered(message);
+#endif
+#if DTN_SINK
+  ///Hand it to the collector
+  return dtn_sink_deliver(message, from);
+#else
+  return 1;
+#endif
+}
+/*
+ * @brief Delivers a bundle that arrived or that we created, and caches it
+ * if it has further to go
+ * @param1 - the bundle, group bundles have the members served marked in it
+ * @param2 - the neighbour that gave it to us, ourselves for our own bundles
+ */
+static void take_bundle(dtn_message *message, const rimeaddr_t *from)
+{
+#if DTN_GROUPS
+  uint8_t member;
+  ///Group bundles are delivered if we are a member and kept going while other members are waiting
+  if(dtn_group_is_group(&message->hdr.message_id.dest)) {
+    member = dtn_group_member_bit(&message->hdr.message_id.dest, &rimeaddr_node_addr) & ~message->hdr.reserved;
+    ///Only marked served once the sink took it, otherwise it is held in the cache like a unicast bundle
+    if(member && deliver_message(message, from)) {
+      message->hdr.reserved |= member;
+      member = 0;
+    }
+    if(member || (message->hdr.reserved != dtn_group_all_members(&message->hdr.message_id.dest) &&
+                  message->hdr.number_of_copies > 0)) {
+      add_to_cache(message);
+    }
+    return;
+  }
+#endif
+  ///If the node has my address, consume the message
+  if (rimeaddr_cmp(&message->hdr.message_id.dest, &rimeaddr_node_addr)) {
+    ///If the sink is backed up keep it in the cache for now
+    if(!deliver_message(message, from)) {
+      PRINTF("--- [SINK] Queue full, holding the bundle in the cache\n");
+      add_to_cache(message);
+    }
+  }
+  else {
+    add_to_cache(message);
+  }
+}
 ///This function is called for every incoming unicast packet.
 static void recv_runicast(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno)
 {
   ///Store the unicast we receive
   dtn_vector *unicast_recieved;
-  dtn_vector_list *add_to_list, *tmp_head, *final_destination_check;
   int i;
+#if DTN_CAPTURE
+  dtn_capture_frame(DTN_CAPTURE_RUNICAST, from, seqno);
+#endif
+#if DTN_FREQ
+  ///Stay on the data frequency in case the neighbour has more or our ack was lost
+  dtn_freq_heard();
+#endif
+#if DTN_DUTY
+  ///More may follow, the neighbour is sending us what we were missing
+  dtn_duty_hold();
+#endif
   ///Returns a pointer to the data in the packet buffer and assign it to unicast received
   unicast_recieved = packetbuf_dataptr();
+  if(received_len(&unicast_recieved->header, offsetof(dtn_vector, message), sizeof(dtn_message)) < 0) {
+    return;
+  }
   ///Iterate through the messages in the packet
   for (i = 0; i < unicast_recieved->header.len; i++) {
-    printf("--- [R-UC] Src: %d.%d | Dest: %d.%d | Copies: %d | Timestamp: %d | Msg %s ---\n",
+    PRINTF("--- [R-UC] Src: %d.%d | Dest: %d.%d | Copies: %d | Timestamp: %d | Msg %s ---\n",
       unicast_recieved->message[i].hdr.message_id.src.u8[0], unicast_recieved->message[i].hdr.message_id.src.u8[1],
       unicast_recieved->message[i].hdr.message_id.dest.u8[0], unicast_recieved->message[i].hdr.message_id.dest.u8[1],
       unicast_recieved->message[i].hdr.number_of_copies, unicast_recieved->message[i].hdr.timestamp,
       unicast_recieved->message[i].msg);
-      ///If the node has my address, consume the message
-      if (unicast_recieved->message[i].hdr.message_id.dest.u8[1] == 9) {
-        printf(" ********** Final desination reached **********\t --- Src: %d.%d | Dest: %d.%d | Copies: %d | Timestamp: %d | Msg *%s* ---\n",
-        unicast_recieved->message[i].hdr.message_id.src.u8[0], unicast_recieved->message[i].hdr.message_id.src.u8[1],
-        unicast_recieved->message[i].hdr.message_id.dest.u8[0], unicast_recieved->message[i].hdr.message_id.dest.u8[1],
-        unicast_recieved->message[i].hdr.number_of_copies, unicast_recieved->message[i].hdr.timestamp,
-        unicast_recieved->message[i].msg);
-        ///Pre-agreed format for testing purposes
-        printf("[RCV-RCH] ");
-        print_msg_id(&unicast_recieved->message[i].hdr.message_id);
-        printf(" from %d.%d", from->u8[0], from->u8[1]);
-        printf(" --%d\n", clock_seconds());
-      }
-      else {
-        ///unicast_recieved->message[i].hdr.number_of_copies = (unicast_recieved->message[i].hdr.number_of_copies / 2);
-        ///Check to see if there is space in the message cache, if so add it to the front.
-        if(list_length(messages_list) < 5){
-          add_to_list = memb_alloc(&messages_memb);
-          memcpy(&add_to_list->message, &unicast_recieved->message[i], sizeof(dtn_message));
-          list_add(messages_list, add_to_list);
-        }
-        /*
-         *If there is not space, pop the last element, deallocate the memory,
-         *assign new memory and add the new message to the front
-         */
-        else if (list_length(messages_list) >= 5){
-          printf("--- [ALERT] Popping last element\n");
-          tmp_head = list_pop(messages_list);
-          memb_free(&messages_memb, tmp_head);
-          add_to_list = memb_alloc(&messages_memb);
-          memcpy(&add_to_list->message, &unicast_recieved->message[i], sizeof(dtn_message));
-          list_add(messages_list, add_to_list);
-        }
-      }
-    }
+    take_bundle(&unicast_recieved->message[i], from);
+  }
 }
 
 /*
@@ -209,21 +695,85 @@ static void recv_runicast(struct runicast_conn *c, const rimeaddr_t *from, uint8
  */
 static void sent_runicast(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions)
 {
-  dtn_vector_list *final_destination_check;
+  dtn_vector_list *final_destination_check, *next;
+  int sent;
+#if DTN_GROUPS
+  uint8_t member;
+#endif
+#if DTN_CAPTURE
+  dtn_capture_outcome(DTN_CAPTURE_SENT, to, retransmissions);
+#endif
   acks ++;
-  printf("--- [ALERT] ******** SUCCESSFULLLY SENT TO %d.%d | TMS; %d ********\n", to->u8[0], to->u8[1], retransmissions);
+  cache_version++;
+#if DTN_LINK
+  dtn_link_acked(to, retransmissions);
+#endif
+#if DTN_FREQ
+  dtn_freq_done();
+#endif
+  PRINTF("--- [ALERT] ******** SUCCESSFULLLY SENT TO %d.%d | TMS; %d ********\n", to->u8[0], to->u8[1], retransmissions);
   ///Iterate through the messagea cache
-  final_destination_check = list_head(messages_list);
-  for(final_destination_check = list_head(messages_list); final_destination_check != NULL; final_destination_check = list_item_next(final_destination_check)) {
+  for(final_destination_check = list_head(messages_list); final_destination_check != NULL; final_destination_check = next) {
+    next = list_item_next(final_destination_check);
+#if DTN_GROUPS
+    /*
+     *Group bundles only change if they were in the acknowledged packet,
+     *a member gets marked as served and the copies were split with the neighbour
+     */
+    if(dtn_group_is_group(&final_destination_check->message.hdr.message_id.dest)) {
+      if(!was_sent(&final_destination_check->message.hdr.message_id, to)) {
+        continue;
+      }
+      member = dtn_group_member_bit(&final_destination_check->message.hdr.message_id.dest, to);
+      final_destination_check->message.hdr.reserved |= member;
+      if(final_destination_check->message.hdr.number_of_copies > 1) {
+        final_destination_check->message.hdr.number_of_copies /= 2;
+      }
+      ///Finished once every member is served or there are no copies left
+      if(final_destination_check->message.hdr.reserved == dtn_group_all_members(&final_destination_check->message.hdr.message_id.dest) ||
+         final_destination_check->message.hdr.number_of_copies == 0) {
+        PRINTF("--- [ALERT] Group bundle finished, cleaning the message list.\n");
+        list_remove(messages_list, final_destination_check);
+        memb_free(&messages_memb, final_destination_check);
+      }
+      continue;
+    }
+#endif
+    ///Only the bundles in the acknowledged packet were handed over
+    sent = find_sent(&final_destination_check->message.hdr.message_id, to);
+    if(sent < 0) {
+      continue;
+    }
+#if DTN_MULTICAST
+    ///A repaired share was accounted for when its frame went out
+    if(dtn_multicast_repaired(&final_destination_check->message.hdr.message_id, to)) {
+      continue;
+    }
+#endif
+#if DTN_PLAN
+    ///A planned bundle is handed over whole, our copy goes once the next hop has it
+    if(sent_planned[sent]) {
+      PRINTF("--- [PLAN] Handed to the next hop, cleaning the message list.\n");
+      dtn_plan_forwarded(&final_destination_check->message.hdr.message_id.dest, to);
+      ///The last hop of a route is usually the destination itself
+      if(rimeaddr_cmp(&final_destination_check->message.hdr.message_id.dest, to)) {
+        dtn_api_delivered(&final_destination_check->message);
+      }
+      list_remove(messages_list, final_destination_check);
+      memb_free(&messages_memb, final_destination_check);
+      continue;
+    }
+#endif
     ///If the message was sent to its final destination then we should remove it from the list
     if (rimeaddr_cmp(&final_destination_check->message.hdr.message_id.dest, to)) {
-      printf("--- [ALERT] Sent to final destination, cleaning the message list.\n");
+      PRINTF("--- [ALERT] Sent to final destination, cleaning the message list.\n");
+      dtn_api_delivered(&final_destination_check->message);
       list_remove(messages_list, final_destination_check);
       memb_free(&messages_memb, final_destination_check);
     }
-    ///Halve the number of copies in the message list upon acknowledgement
+    ///Otherwise the strategy decides what we keep, binary halves the copies
     else {
-      final_destination_check->message.hdr.number_of_copies /= 2;
+      final_destination_check->message.hdr.number_of_copies = dtn_route.on_ack(&final_destination_check->message, to);
     }
   }
 }
@@ -235,12 +785,406 @@ static void sent_runicast(struct runicast_conn *c, const rimeaddr_t *to, uint8_t
  */
 static void timedout_runicast(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions)
 {
-  printf("--- [ALERT] Runicast message timed out when sending to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
+  PRINTF("--- [ALERT] Runicast message timed out when sending to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
+#if DTN_CAPTURE
+  dtn_capture_outcome(DTN_CAPTURE_TIMEDOUT, to, retransmissions);
+#endif
   ///Used for testing purposes
   timeouts ++;
+#if DTN_LINK
+  dtn_link_timedout(to);
+#endif
+#if DTN_FREQ
+  dtn_freq_done();
+#endif
+  if(dtn_route.on_timeout != NULL) {
+    dtn_route.on_timeout(to);
+  }
 }
 static const struct runicast_callbacks runicast_callbacks = {recv_runicast, sent_runicast, timedout_runicast};
+#if DTN_REPLAY
+///The native radio never gets an ack, the outcomes come from the capture instead
+static const struct runicast_callbacks replay_callbacks = {recv_runicast, NULL, NULL};
+#endif
 static struct runicast_conn runicast;
+#if DTN_SINK
+/*
+ * @brief Called by the sink when its queue has room, moves any bundles
+ * held in the cache for the collector over to the sink
+ */
+static void sink_room(void)
+{
+  dtn_vector_list *held, *next;
+#if DTN_GROUPS
+  uint8_t member;
+#endif
+  for(held = list_head(messages_list); held != NULL; held = next) {
+    next = list_item_next(held);
+#if DTN_GROUPS
+    ///A group bundle we are a member of and have not been served yet
+    if(dtn_group_is_group(&held->message.hdr.message_id.dest)) {
+      member = dtn_group_member_bit(&held->message.hdr.message_id.dest, &rimeaddr_node_addr) & ~held->message.hdr.reserved;
+      if(!member) {
+        continue;
+      }
+      if(!dtn_sink_deliver(&held->message, &rimeaddr_node_addr)) {
+        return;
+      }
+      held->message.hdr.reserved |= member;
+      cache_version++;
+      if(held->message.hdr.reserved == dtn_group_all_members(&held->message.hdr.message_id.dest) ||
+         held->message.hdr.number_of_copies == 0) {
+        list_remove(messages_list, held);
+        memb_free(&messages_memb, held);
+      }
+      continue;
+    }
+#endif
+    if(rimeaddr_cmp(&held->message.hdr.message_id.dest, &rimeaddr_node_addr)) {
+      if(!dtn_sink_deliver(&held->message, &rimeaddr_node_addr)) {
+        return;
+      }
+      list_remove(messages_list, held);
+      memb_free(&messages_memb, held);
+      cache_version++;
+    }
+  }
+}
+#endif
+#if DTN_CUSTODY
+/*
+ * @brief Called when a neighbour offers us custody of a bundle, nothing is
+ * taken until our answer is acknowledged but a slot is kept for it
+ * @param1 - the offered bundle
+ * @return DTN_CUSTODY_ACCEPTED, or the reason we refused
+ */
+static uint8_t custody_check(const dtn_message *message)
+{
+  ///Taking custody must never push out a bundle we already hold
+  if(list_length(messages_list) + custody_held >= MAX_MESSAGES) {
+    return DTN_CUSTODY_REFUSED_NO_SPACE;
+  }
+  ///Bundles arriving meanwhile pop older ones rather than take this slot
+  custody_held++;
+  return DTN_CUSTODY_ACCEPTED;
+}
+/*
+ * @brief The neighbour has our acceptance and has freed its copy, take the bundle
+ * @param1 - the bundle
+ * @param2 - the neighbour that offered it
+ */
+static void custody_accept(const dtn_message *message, const rimeaddr_t *from)
+{
+  custody_held--;
+  if(rimeaddr_cmp(&message->hdr.message_id.dest, &rimeaddr_node_addr) && deliver_message(message, from)) {
+    return;
+  }
+  ///The kept slot should still be there, if not we refuse rather than push a bundle out
+  if(find_in_cache(&message->hdr.message_id) == NULL && list_length(messages_list) >= cache_room()) {
+    PRINTF("--- [CUSTODY] No room left for the bundle, refused\n");
+    return;
+  }
+  ///Joins a copy we already hold, taking over the sender's copies as well
+  add_to_cache(message);
+}
+/*
+ * @brief Our acceptance never reached the neighbour, it keeps the bundle
+ */
+static void custody_cancel(void)
+{
+  custody_held--;
+}
+/*
+ * @brief Called when a custodian accepted one of our bundles, frees our copy
+ * @param1 - the message id
+ */
+static void custody_release(const dtn_msg_id *id)
+{
+  dtn_vector_list *tmp;
+  for(tmp = list_head(messages_list); tmp != NULL; tmp = list_item_next(tmp)) {
+    if(rimeaddr_cmp(&tmp->message.hdr.message_id.src, &id->src) &&
+       rimeaddr_cmp(&tmp->message.hdr.message_id.dest, &id->dest) &&
+       tmp->message.hdr.message_id.seq == id->seq) {
+      list_remove(messages_list, tmp);
+      memb_free(&messages_memb, tmp);
+      cache_version++;
+      return;
+    }
+  }
+}
+#endif
+/*
+ * @brief Fills in the summary vector advertised in our broadcasts
+ * @param1 - the summary vector to fill
+ * @return the number of message ids added
+ */
+static int build_summary_vector(dtn_summary_vector *send)
+{
+  dtn_vector_list *my_vector;
+  dtn_header header;
+  int i = 0;
+  int free_slots;
+  ///Iterate through my messages cache
+  for(my_vector = list_head(messages_list); my_vector != NULL && i < MAX_MSG_VECTORS; my_vector = list_item_next(my_vector)) {
+    /*Add each message in the cache to a summary vector to be
+     *sent out in the broadcast
+     * and increment the array index value
+     */
+    send->message_ids[i++] = (my_vector->message.hdr.message_id);
+  }
+  ///Assign the type and the number of messages in the vector
+  header.type = DTN_SUMMARY_VECTOR;
+  header.len = i;
+  send->header = header;
+  send->flags = 0;
+#if DTN_CUSTODY && DTN_CUSTODY_CUSTODIAN
+  send->flags |= DTN_FLAG_CUSTODIAN;
+#endif
+  ///Advertise how much we can take before anything gets popped
+  free_slots = cache_room() - list_length(messages_list);
+  send->free_slots = free_slots > 255 ? 255 : free_slots;
+  send->free_bytes = free_slots * sizeof(dtn_message) > 0xffff ? 0xffff : free_slots * sizeof(dtn_message);
+  if(evicted) {
+    send->flags |= DTN_FLAG_CONGESTED;
+    evicted = 0;
+  }
+  send->time = dtn_time_now();
+  send->time_level = dtn_time_level();
+#if DTN_DUTY
+  send->wake_phase = dtn_duty_phase();
+#else
+  send->wake_phase = DTN_DUTY_NO_PHASE;
+#endif
+  return i;
+}
+#if DTN_CODING
+/*
+ * @brief A neighbour acknowledged a bundle from a coded frame, the same
+ * bookkeeping sent_runicast does for the bundles in a runicast packet
+ * @param1 - the message id
+ * @param2 - the neighbour
+ */
+static void coded_sent(const dtn_msg_id *id, const rimeaddr_t *to)
+{
+  dtn_vector_list *tmp;
+  for(tmp = list_head(messages_list); tmp != NULL; tmp = list_item_next(tmp)) {
+    if(rimeaddr_cmp(&tmp->message.hdr.message_id.src, &id->src) &&
+       rimeaddr_cmp(&tmp->message.hdr.message_id.dest, &id->dest) &&
+       tmp->message.hdr.message_id.seq == id->seq) {
+      cache_version++;
+      if(rimeaddr_cmp(&tmp->message.hdr.message_id.dest, to)) {
+        dtn_api_delivered(&tmp->message);
+        list_remove(messages_list, tmp);
+        memb_free(&messages_memb, tmp);
+      }
+      else {
+        tmp->message.hdr.number_of_copies = dtn_route.on_ack(&tmp->message, to);
+      }
+      return;
+    }
+  }
+}
+#endif
+#if DTN_CODING || DTN_MULTICAST
+/*
+ * @brief A bundle came in a coded or multicast frame, handled as if it came in a runicast packet
+ * @param1 - the bundle
+ * @param2 - the neighbour that sent the frame
+ */
+static void frame_received(const dtn_message *message, const rimeaddr_t *from)
+{
+  scratch.vector.header.type = DTN_MESSAGE;
+  scratch.vector.header.len = 1;
+  scratch.vector.message[0] = *message;
+  packetbuf_copyfrom(&scratch.vector, sizeof(dtn_vector));
+  recv_runicast(&runicast, from, 0);
+}
+#endif
+#if DTN_MULTICAST
+/*
+ * @brief Shares a bundle's copies between the receivers of a multicast frame.
+ * They get what the routing strategy would have handed them one runicast
+ * after another, evened out between them when that hands over copies we
+ * give up, and we keep what it would have left us.
+ * @param1 - the bundle in our cache
+ * @param2 - the receivers
+ * @param3 - how many
+ * @param4 - where to write the copies each receiver takes
+ * @return 0 if the bundle has to go to each receiver by runicast
+ */
+static int multicast_split(dtn_message *message, const rimeaddr_t *to, uint8_t n, uint8_t *copies)
+{
+  dtn_message left;
+  int i, given = 0;
+#if DTN_PLAN
+  rimeaddr_t hop;
+  ///Planned bundles go whole to one next hop
+  if(dtn_plan_next_hop(&message->hdr.message_id.dest, &hop)) {
+    return 0;
+  }
+#endif
+#if DTN_GROUPS
+  ///Group bundles track the members served
+  if(dtn_group_is_group(&message->hdr.message_id.dest)) {
+    return 0;
+  }
+#endif
+#if DTN_SINK
+  if(rimeaddr_cmp(&message->hdr.message_id.dest, &rimeaddr_node_addr)) {
+    return 0;
+  }
+#endif
+  left = *message;
+  for(i = 0; i < n; i++) {
+    if(!dtn_route.should_forward(&left, &to[i])) {
+      return 0;
+    }
+    copies[i] = dtn_route.hand_over(&left, &to[i]);
+    given += copies[i];
+    left.hdr.number_of_copies = dtn_route.on_ack(&left, &to[i]);
+  }
+  if(given + left.hdr.number_of_copies == message->hdr.number_of_copies) {
+    for(i = 0; i < n; i++) {
+      copies[i] = given / n + (i < given % n);
+    }
+  }
+  message->hdr.number_of_copies = left.hdr.number_of_copies;
+  cache_version++;
+  return 1;
+}
+/*
+ * @brief Sends a neighbour the bundles from the multicast window only it was missing
+ * @param1 - the neighbour
+ * @param2 - their message ids
+ * @param3 - how many
+ */
+static void multicast_unicast(const rimeaddr_t *to, const dtn_msg_id *ids, uint8_t n)
+{
+  dtn_vector_list *tmp;
+  int i, b = 0;
+#if DTN_OVERHEAR
+  if(dtn_overhear_pending()) {
+    return;
+  }
+#endif
+#if DTN_FREQ
+  if(dtn_freq_busy()) {
+    return;
+  }
+#endif
+  if(runicast_is_transmitting(&runicast)) {
+    return;
+  }
+  for(tmp = list_head(messages_list); tmp != NULL && b < DTN_VECTOR_MESSAGES; tmp = list_item_next(tmp)) {
+    for(i = 0; i < n; i++) {
+      if(rimeaddr_cmp(&ids[i].src, &tmp->message.hdr.message_id.src) &&
+         rimeaddr_cmp(&ids[i].dest, &tmp->message.hdr.message_id.dest) &&
+         ids[i].seq == tmp->message.hdr.message_id.seq) {
+        b += spray_copy(&tmp->message, to, &unicast_message.message[b]);
+        break;
+      }
+    }
+  }
+  if(b == 0) {
+    return;
+  }
+  unicast_message.header.type = DTN_MESSAGE;
+  unicast_message.header.len = b;
+  send_unicast(to);
+}
+#endif
+#if DTN_ANNOUNCE
+/*
+ * @brief Digest of every message id in the cache, the same set of bundles
+ * gives the same digest whatever order they were cached in
+ */
+static uint16_t cache_digest(void)
+{
+  dtn_vector_list *tmp;
+  uint16_t digest = 0;
+  for(tmp = list_head(messages_list); tmp != NULL; tmp = list_item_next(tmp)) {
+    digest += dtn_announce_hash(&tmp->message.hdr.message_id);
+  }
+  return digest;
+}
+#endif
+/*
+ * @brief The number of copies a new bundle starts with
+ */
+static uint8_t initial_copies(void)
+{
+#if DTN_ADAPT
+  ///Sized for the target delay from what we have seen of the network
+  return dtn_adapt_copies();
+#else
+  return 1;
+#endif
+}
+/*
+ * @brief Creates a bundle from this node and puts it in the cache, as if
+ * it had arrived in a runicast packet
+ */
+int dtn_send(const rimeaddr_t *dest, const void *payload, uint8_t len, uint8_t copies, uint8_t priority)
+{
+  ///8 bits like the message id it goes in, wraps after 255 (see dtn-api.h)
+  static uint8_t seq;
+  dtn_message created;
+  if(len > MAX_MSG_SIZE) {
+    return -1;
+  }
+#if DTN_CAPTURE
+  dtn_capture_send(dest, payload, len, copies, priority);
+#endif
+  ///Pack the message
+  created.hdr.message_id.dest = *dest;
+  created.hdr.message_id.src = rimeaddr_node_addr;
+  created.hdr.message_id.seq = ++seq;
+  created.hdr.number_of_copies = copies > 0 ? copies : initial_copies();
+  created.hdr.timestamp = dtn_time_now();
+  created.hdr.length = len;
+  created.hdr.reserved = 0;
+  created.hdr.priority = priority;
+  memset(created.msg, 0, MAX_MSG_SIZE);
+  memcpy(created.msg, payload, len);
+  ///Print in the log aggregated format
+  printf("[MSG-CRT] ");
+  print_msg_id(&created.hdr.message_id);
+  printf(" --%lu\n", (unsigned long)dtn_time_now());
+  ///Straight in to the cache, nothing arrived so the receive path is left out
+  take_bundle(&created, &rimeaddr_node_addr);
+  return seq;
+}
+#if !DTN_REPLAY && !DTN_BENCH
+/*
+ * @brief Creates a test bundle
+ * @param1 - the destination
+ * @param2 - the number of copies to spray
+ */
+static void create_message(const rimeaddr_t *dest, uint8_t copies)
+{
+  dtn_send(dest, "arch", 4, copies, DTN_PRIORITY_NORMAL);
+}
+#endif
+#if DTN_LIFETIME
+/*
+ * @brief Drops the bundles older than DTN_LIFETIME, our own are reported to their endpoint
+ */
+static void expire_bundles(void)
+{
+  dtn_vector_list *tmp, *next;
+  uint32_t now = dtn_time_now();
+  for(tmp = list_head(messages_list); tmp != NULL; tmp = next) {
+    next = list_item_next(tmp);
+    ///A timestamp ahead of our clock came from a node whose clock runs ahead
+    if(now > tmp->message.hdr.timestamp && now - tmp->message.hdr.timestamp > DTN_LIFETIME) {
+      dtn_api_expired(&tmp->message);
+      list_remove(messages_list, tmp);
+      memb_free(&messages_memb, tmp);
+      cache_version++;
+    }
+  }
+}
+#endif
 /*
  * @brief Single protohead, called when an event occurs
  * @param1 - the defined process parameter
@@ -251,69 +1195,161 @@ PROCESS_THREAD(broadcast_process, ev, data)
 {
   ///Define strutures and variables used in the process
   static struct etimer et;
-  int i, h;
-  static dtn_summary_vector send;
-  dtn_vector_list *my_vector;
-  dtn_header header;
-  rimeaddr_t node_addr;
+#ifdef DTN_CONF_NODE_ADDR
+  rimeaddr_t node_addr = DTN_CONF_NODE_ADDR;
+#endif
 
   PROCESS_EXITHANDLER(broadcast_close(&broadcast);)
   PROCESS_BEGIN();
-  ///Define the power used for testing and the node address to use
+  ///Define the power used for testing
+#if !DTN_REPLAY && !DTN_BENCH && !DTN_SIM
   set_power(1);
-  node_addr.u8[0] = 128;
-  node_addr.u8[1] = 9;
+#endif
+#ifdef DTN_CONF_NODE_ADDR
+  ///A fixed address for test images, otherwise the one Rime was configured with
   rimeaddr_set_node_addr(&node_addr);
+#endif
   ///First open the broadcast and unicast connections and assign the channels used
-  broadcast_open(&broadcast, 229, &broadcast_call);
-  runicast_open(&runicast, 244, &runicast_callbacks);
+  broadcast_open(&broadcast, DTN_BROADCAST_CHANNEL, &broadcast_call);
+#if DTN_REPLAY
+  runicast_open(&runicast, DTN_RUNICAST_CHANNEL, &replay_callbacks);
+#else
+  runicast_open(&runicast, DTN_RUNICAST_CHANNEL, &runicast_callbacks);
+#endif
+#if DTN_CAPTURE
+  dtn_capture_init(&rimeaddr_node_addr);
+#endif
+#if DTN_REPLAY
+  ///Takes over the node address and seed from the capture, at the point capture reseeded
+  dtn_replay_init();
+#endif
+#if DTN_SINK
+  dtn_sink_init(sink_room);
+#endif
+#if DTN_CUSTODY
+  {
+    static const struct dtn_custody_hooks custody_hooks = {custody_check, custody_accept, custody_cancel, custody_release};
+    dtn_custody_open(&custody_hooks);
+  }
+#endif
+#if DTN_CODING
+  {
+    static const struct dtn_coding_hooks coding_hooks = {spray_copy, coded_sent, frame_received};
+    dtn_coding_open(messages_list, &coding_hooks);
+  }
+#endif
+#if DTN_ANNOUNCE
+  ///Neighbours asking for our summary vector poll this process
+  dtn_announce_open(&broadcast_process);
+#endif
+#if DTN_PLAN
+  dtn_plan_open();
+#endif
+#if DTN_DUTY
+  dtn_duty_open();
+#endif
+#if DTN_MULTICAST
+  {
+    static const struct dtn_multicast_hooks multicast_hooks = {multicast_split, multicast_unicast, frame_received};
+    dtn_multicast_open(messages_list, &multicast_hooks);
+  }
+#endif
+#if DTN_OVERHEAR
+  {
+    static const struct dtn_overhear_hooks overhear_hooks = {overheard, held_send};
+    dtn_overhear_open(DTN_RUNICAST_CHANNEL, &overhear_hooks);
+  }
+#endif
+#if DTN_FREQ
+  {
+    static const struct dtn_freq_hooks freq_hooks = {freq_send};
+    dtn_freq_open(&freq_hooks);
+  }
+#endif
+#if DTN_SAMPLE && !DTN_REPLAY && !DTN_BENCH
+  dtn_sample_open();
+#endif
+#if DTN_REPLAY
+  dtn_replay_start(&broadcast, &broadcast_call, &runicast, &runicast_callbacks);
+#endif
+#if DTN_SIM
+  ///Takes over the node address, bundles are created by the simulator
+  {
+    static const struct dtn_sim_hooks hooks = {create_message, &total_unicast_sent, &acks, &timeouts};
+    dtn_sim_start(&hooks);
+  }
+#endif
+#if DTN_BENCH
+  {
+    static const struct dtn_bench_hooks hooks = {&broadcast, &broadcast_call,
+      &runicast, &runicast_callbacks, build_summary_vector, &total_allocs};
+    dtn_bench_start(&hooks);
+  }
+#endif
   ///Keep looping
   while(1) {
+#if DTN_DUTY
+      ///Beacon inside the next wake window
+      etimer_set(&et, dtn_duty_beacon_delay());
+#else
       ///Define the randon time period with broadcast within
-      etimer_set(&et, CLOCK_SECOND * 2 + random_rand() % (CLOCK_SECOND * 5));
+      etimer_set(&et, DTN_BEACON_MIN + random_rand() % DTN_BEACON_SPREAD);
+#endif
       ///Block until x seconds is reached
+#if DTN_ANNOUNCE
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || ev == PROCESS_EVENT_POLL);
+#else
       PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
-      i = 0;
-      ///Iterate through my messages cache
-      for(my_vector = list_head(messages_list); my_vector != NULL; my_vector = list_item_next(my_vector)) {
-        // printf("--- [BC VECTOR ITEM]: Src: %d.%d | Dest: %d.%d | Seq: %d --- \n",
-        // my_vector->message.hdr.message_id.src.u8[0], my_vector->message.hdr.message_id.src.u8[1],
-        // my_vector->message.hdr.message_id.dest.u8[0], my_vector->message.hdr.message_id.dest.u8[1],
-        // my_vector->message.hdr.message_id.seq);
-
-        /*Add each message in the cache to a summary vector to be
-         *sent out in the broadcast
-         * and increment the array index value
-         */
-        send.message_ids[i++] = (my_vector->message.hdr.message_id);
+#endif
+#if DTN_PLAN
+      ///Contacts that are over make room for the next ones in the plan
+      dtn_plan_refresh();
+#endif
+#if DTN_LIFETIME
+      expire_bundles();
+#endif
+#if DTN_CUSTODY && !DTN_CUSTODY_CUSTODIAN
+      ///Running out of room, hand the oldest bundle to a custodian before it gets popped
+      if(list_length(messages_list) > 0 && list_length(messages_list) >= MAX_MESSAGES - DTN_CUSTODY_HEADROOM) {
+        dtn_custody_offer(&((dtn_vector_list *)list_head(messages_list))->message);
       }
-      ///Assign the type and the number of messages in the vector
-      header.type = DTN_SUMMARY_VECTOR;
-      header.len = i;
-      send.header = header;
-      send.message_ids;
+#endif
+#if DTN_ANNOUNCE
+      ///The digest rides on Rime's announcements, the summary vector only goes out when asked for
+      dtn_announce_digest(cache_digest());
+      if(!dtn_announce_due()) {
+        continue;
+      }
+#endif
+#if DTN_FREQ
+      ///Off the control frequency nobody would hear it
+      if(dtn_freq_busy()) {
+        continue;
+      }
+#endif
+      build_summary_vector(&scratch.summary);
       ///Make sure runicast is not already transmitting
       if(!runicast_is_transmitting(&runicast)) {
         ///Make sure the size is same expected structure
-        packetbuf_copyfrom(&send, sizeof(dtn_summary_vector));
+        packetbuf_copyfrom(&scratch.summary, sizeof(dtn_summary_vector));
         ///Send the broadcast
         broadcast_send(&broadcast);
+#if DTN_ANNOUNCE
+        dtn_announce_sent();
+#endif
       }
   }
   PROCESS_END();
 }
+#if !DTN_REPLAY && !DTN_BENCH && !DTN_SIM
 /*This process is used to test runicast recieve, inject messages in to cache
  *and to print out the message cache at a given time
  */
 PROCESS_THREAD(button_actions, ev, data)
 {
   ///Declarations
-  rimeaddr_t node_addr, dest_addr;
-  static dtn_summary_vector sim_broadcast;
-  static dtn_vector sim_unicast;
+  rimeaddr_t dest_addr;
   static dtn_vector_list *m;
-  dtn_header header;
-  int i, b;
   PROCESS_BEGIN();
   ///Activate the buttons for use
   SENSORS_ACTIVATE(button_sensor);
@@ -326,38 +1362,19 @@ PROCESS_THREAD(button_actions, ev, data)
       if (ev == sensors_event && data == &button_sensor) {
         ///Make sure runiacst isnt broadcasting before we call the receive function
         if(!runicast_is_transmitting(&runicast)) {
-          ///Pack the message
-          rimeaddr_copy(&node_addr, &rimeaddr_null);
-          node_addr.u8[0] = 128;
-          node_addr.u8[1] = 9;
-          header.ver = 3;
-          header.type = 2;
-          header.len = 1;
           rimeaddr_copy(&dest_addr, &rimeaddr_null);
+#if DTN_GROUPS
+          ///Address test bundles to the first group
+          dtn_group_first(&dest_addr);
+#else
           ///Pick a random destination, make sure I am not the destination
           do {
               dest_addr.u8[0] = 128;
               dest_addr.u8[1] = 1 + random_rand()%10;
               }
-              while(dest_addr.u8[1] == 9);
-          ///Add the (one) message to the simulate unicast variable
-          for (i = 0; i < header.len; i++) {
-            sim_unicast.message[i].hdr.message_id.dest = dest_addr;
-            sim_unicast.message[i].hdr.message_id.src =  node_addr;
-            sim_unicast.message[i].hdr.message_id.seq = i;
-            sim_unicast.message[i].hdr.number_of_copies =  1;
-            sim_unicast.message[i].hdr.timestamp =  clock_seconds();
-            sim_unicast.message[i].hdr.length =  header.len;
-            strncpy(sim_unicast.message[i].msg, "arch", 5);
-            ///Print in the log aggregated format
-            printf("[MSG-CRT] ");
-            print_msg_id(&sim_unicast.message[i].hdr.message_id);
-            printf(" --%d\n", clock_seconds());
-          }
-          sim_unicast.header = header;
-          packetbuf_copyfrom(&sim_unicast, sizeof(dtn_vector));
-          ///Call the receive unicast function and pass the packet
-          recv_runicast(&runicast, &dest_addr, MAX_RETRANSMISSIONS);
+              while(dest_addr.u8[1] == rimeaddr_node_addr.u8[1]);
+#endif
+          create_message(&dest_addr, 0);
       }
     }
     ///Print the message cache
@@ -385,3 +1402,4 @@ PROCESS_THREAD(button_actions, ev, data)
   }
   PROCESS_END();
 }
+#endif /* !DTN_REPLAY && !DTN_BENCH && !DTN_SIM */
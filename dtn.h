@@ -8,13 +8,104 @@
  * the best-effort and reliable communication abstractions.
  *
  */
+#ifndef __DTN_H__
+#define __DTN_H__
 #include "contiki.h"
 #include "net/rime.h"
 #include <stdint.h>
-///Specify the number of messages we can hold and the message size
-#define MAX_MESSAGES 5
-#define MAX_MSG_VECTORS MAX_MESSAGES
+///Bundle payload bytes, sensor bundles (dtn-sample.h) want more than the default
+#ifdef DTN_CONF_MAX_MSG_SIZE
+#define MAX_MSG_SIZE DTN_CONF_MAX_MSG_SIZE
+#else
 #define MAX_MSG_SIZE 5
+#endif
+///Frames and bundles are packed, nothing is lost to padding and sky and OrisenPrime nodes agree on the layout
+#ifdef __GNUC__
+#define DTN_PACKED __attribute__((__packed__))
+#else
+#define DTN_PACKED
+#endif
+///Breaks the build when cond does not hold, name says what went wrong
+#define DTN_STATIC_ASSERT(cond, name) typedef char dtn_assert_##name[(cond) ? 1 : -1]
+///Packed sizes for the preprocessor, dtn.c checks them against sizeof
+#define DTN_MSG_ID_SIZE (2 * RIMEADDR_SIZE + 1)
+#define DTN_MESSAGE_SIZE (8 + DTN_MSG_ID_SIZE + MAX_MSG_SIZE)
+#ifdef __SIZEOF_POINTER__
+#define DTN_POINTER_SIZE __SIZEOF_POINTER__
+#else
+#define DTN_POINTER_SIZE 4
+#endif
+/*
+ *RAM one cached bundle takes: its list entry, the next pointer and the
+ *bundle rounded up to the pointer alignment, and its byte in the memb count
+ */
+#define DTN_CACHE_ENTRY_SIZE ((DTN_POINTER_SIZE + DTN_MESSAGE_SIZE + DTN_POINTER_SIZE - 1) / \
+                              DTN_POINTER_SIZE * DTN_POINTER_SIZE + 1)
+///RAM set aside for the bundle cache, each target holds as many bundles as fit in it and a beacon lists
+#ifdef DTN_CONF_CACHE_RAM
+#define DTN_CACHE_RAM DTN_CONF_CACHE_RAM
+#elif defined(CONTIKI_TARGET_SKY)
+///10 KB in all, Contiki, Rime and the stack take most of it
+#define DTN_CACHE_RAM 1024
+#elif defined(CONTIKI_TARGET_ORISENPRIME)
+///96 KB in all, the image and its stack take about 53 KB
+#define DTN_CACHE_RAM 12288
+#elif defined(DTN_CONF_MAX_MESSAGES)
+///Native builds and the simulator take whatever they are told to hold
+#define DTN_CACHE_RAM (DTN_CONF_MAX_MESSAGES * DTN_CACHE_ENTRY_SIZE)
+#else
+#define DTN_CACHE_RAM (5 * DTN_CACHE_ENTRY_SIZE)
+#endif
+///Message ids that fit in a beacon after the 13 byte summary vector header
+#define DTN_SUMMARY_ROOM ((PACKETBUF_SIZE - 13) / DTN_MSG_ID_SIZE)
+/*
+ *Specify the number of messages we can hold, a fixed count has to fit DTN_CACHE_RAM too.
+ *By default no more than one beacon lists, a neighbour sends us again every
+ *bundle our summary leaves out.
+ */
+#ifdef DTN_CONF_MAX_MESSAGES
+#define MAX_MESSAGES DTN_CONF_MAX_MESSAGES
+#elif DTN_CACHE_RAM / DTN_CACHE_ENTRY_SIZE > DTN_SUMMARY_ROOM
+#define MAX_MESSAGES DTN_SUMMARY_ROOM
+#else
+#define MAX_MESSAGES (DTN_CACHE_RAM / DTN_CACHE_ENTRY_SIZE)
+#endif
+#ifdef DTN_CONF_MAX_MSG_VECTORS
+#define MAX_MSG_VECTORS DTN_CONF_MAX_MSG_VECTORS
+#elif MAX_MESSAGES > DTN_SUMMARY_ROOM
+#define MAX_MSG_VECTORS DTN_SUMMARY_ROOM
+#else
+#define MAX_MSG_VECTORS MAX_MESSAGES
+#endif
+///Summary vectors are broadcast every DTN_BEACON_MIN plus a random part of DTN_BEACON_SPREAD
+#ifdef DTN_CONF_BEACON_MIN
+#define DTN_BEACON_MIN DTN_CONF_BEACON_MIN
+#else
+#define DTN_BEACON_MIN (CLOCK_SECOND * 2)
+#endif
+#ifdef DTN_CONF_BEACON_SPREAD
+#define DTN_BEACON_SPREAD DTN_CONF_BEACON_SPREAD
+#else
+#define DTN_BEACON_SPREAD (CLOCK_SECOND * 5)
+#endif
+///Rime channels for the summary vectors and the bundle transfers, set in project-conf.h
+#ifndef DTN_BROADCAST_CHANNEL
+#define DTN_BROADCAST_CHANNEL 129
+#endif
+#ifndef DTN_RUNICAST_CHANNEL
+#define DTN_RUNICAST_CHANNEL 144
+#endif
+///Protocol chatter can be compiled out, the [MSG-CRT]/[RCV-RCH] records are always printed
+#ifdef DTN_CONF_DEBUG
+#define DEBUG DTN_CONF_DEBUG
+#else
+#define DEBUG 1
+#endif
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
 ///Enumerate message types
 enum
 {
@@ -23,13 +114,13 @@ enum
 	DTN_MESSAGE = 2,
 	DTN_MESSAGE_DELIVERY = 3
 };
-///Holds the size of each value in the packet header
+///Holds the size of each value in the packet header, the same two bytes whatever the cache size
 typedef struct
 {
-  uint8_t ver  : 3;
-  uint8_t type : 2;
-  uint8_t len  : 3;
-}dtn_header;
+  uint16_t ver  : 3;
+  uint16_t type : 2;
+  uint16_t len  : 11;
+}DTN_PACKED dtn_header;
 /*
  *Specify the atrtibutes sent in the summary
  *vector during hte boradcast message
@@ -39,7 +130,7 @@ typedef struct
 	rimeaddr_t dest;
 	rimeaddr_t src;
 	uint8_t seq;
-}dtn_msg_id;
+}DTN_PACKED dtn_msg_id;
 /*
  *Define the message header fields,
  *message_id holds the struct dtn_msg_id
@@ -52,8 +143,11 @@ typedef struct
 	uint8_t number_of_copies;
 	uint8_t length;
 	dtn_msg_id  message_id;
+	///Bitmap of members served for group addressed bundles (dtn-group.h)
 	uint8_t reserved;
-}dtn_msg_header;
+	///DTN_PRIORITY_* from dtn-api.h
+	uint8_t priority;
+}DTN_PACKED dtn_msg_header;
 /*
  *The is strcutre sent and received in broadcast
  *messages telling neighbours which messages we/they
@@ -62,8 +156,22 @@ typedef struct
 typedef struct
 {
 	dtn_header header;
+	///DTN_FLAG_* bits describing the sender
+	uint8_t flags;
+	///Free space in the sender's cache (dtn-backpressure.h)
+	uint16_t free_bytes;
+	uint8_t free_slots;
+	///Network time of the sender and its hops to the time root (dtn-time.h)
+	uint32_t time;
+	uint8_t time_level;
+	///How far in to its own wake window the sender is, in ms (dtn-duty.h)
+	uint16_t wake_phase;
 	dtn_msg_id message_ids[MAX_MSG_VECTORS];
-}dtn_summary_vector;
+}DTN_PACKED dtn_summary_vector;
+///The sender takes custody of bundles offered to it (dtn-custody.h)
+#define DTN_FLAG_CUSTODIAN 0x01
+///The sender has popped bundles from a full cache since its last beacon
+#define DTN_FLAG_CONGESTED 0x02
 /*
  *This struct contains the actual message_ids
  *sent with the mesage header
@@ -72,7 +180,11 @@ typedef struct
 {
 	dtn_msg_header hdr;
 	char msg[MAX_MSG_SIZE];
-}dtn_message;
+}DTN_PACKED dtn_message;
+///Bundles that fit in one runicast frame after the header
+#define DTN_FRAME_MESSAGES ((int)((PACKETBUF_SIZE - sizeof(dtn_header)) / sizeof(dtn_message)))
+///A packet never carries more bundles than the cache holds or the frame fits
+#define DTN_VECTOR_MESSAGES (MAX_MESSAGES < DTN_FRAME_MESSAGES ? MAX_MESSAGES : DTN_FRAME_MESSAGES)
 /*
  *This is sent in a runicast message to a
  * neighbour and received in a runicast message_ids
@@ -80,14 +192,25 @@ typedef struct
 typedef struct
 {
 	dtn_header header;
-	dtn_message message[MAX_MESSAGES];
-}dtn_vector;
+	dtn_message message[DTN_VECTOR_MESSAGES];
+}DTN_PACKED dtn_vector;
 /*
  *This was created with a next pointer
- *for iteration purposes
+ *for iteration purposes. Not packed, list.c
+ *needs the pointer aligned.
  */
 typedef struct
 {
 	struct dtn_vector_list *next;
 	dtn_message message;
 }dtn_vector_list;
+/*
+ *Frames are built here before they are copied in to the packet buffer,
+ *one at a time, so they share the space
+ */
+typedef union
+{
+	dtn_vector vector;
+	dtn_summary_vector summary;
+}dtn_frame_scratch;
+#endif /* __DTN_H__ */
@@ -0,0 +1,20 @@
+#!/bin/bash
+###Write a text contact plan as the binary plan dtn-plan.c reads from CFS
+###usage: ./plan.sh plan.txt dtn.plan
+###One contact per line, "start end from to capacity", e.g. "600 900 128.1 128.2 5"
+###for 128.1 being able to send 128.2 five bundles between 600 and 900 seconds.
+###Lines are sorted by start time, contacts are one way.
+plan=$1
+out=${2:-dtn.plan}
+le() { printf "%0$(($2*2))x" $1 | fold -w2 | tac | tr -d '\n'; }
+{
+    printf "44544e5001"
+    grep -v "^#" $plan | sort -n -k1 | while read start end from to capacity;
+    do
+        [ -z "$capacity" ] && continue
+        le $start 4; le $end 4
+        printf "%02x%02x" ${from%.*} ${from#*.}
+        printf "%02x%02x" ${to%.*} ${to#*.}
+        le $capacity 2
+    done
+} | xxd -r -p > $out
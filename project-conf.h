@@ -8,4 +8,68 @@
 #define DTN_BROADCAST_CHANNEL 129
 #define DTN_RUNICAST_CHANNEL 144
 
+///RAM for the bundle cache, it holds as many bundles as fit, 1 KB on sky and 12 KB on OrisenPrime unless set (see dtn.h)
+// #define DTN_CONF_CACHE_RAM 2048
+
+///Record incoming frames for replay, DTN_CAPTURE_SERIAL or DTN_CAPTURE_CFS (see dtn-capture.h)
+// #define DTN_CONF_CAPTURE DTN_CAPTURE_SERIAL
+
+///Send delivered bundles over SLIP to tools/dtn-collector.c (see dtn-sink.h)
+// #define DTN_CONF_SINK 1
+
+///Group addressed bundles, members are listed in DTN_GROUP_CONF_TABLE (see dtn-group.h)
+// #define DTN_CONF_GROUPS 1
+
+///Offload bundles to neighbours that take custody, custodians also set DTN_CUSTODY_CONF_CUSTODIAN (see dtn-custody.h)
+// #define DTN_CONF_CUSTODY 1
+
+///Only send neighbours what their advertised free cache space can hold (see dtn-backpressure.h)
+// #define DTN_CONF_BACKPRESSURE 1
+
+///Network time from beacons for comparable timestamps, one node also sets DTN_TIME_CONF_ROOT (see dtn-time.h)
+// #define DTN_CONF_TIMESYNC 1
+
+///Cache digest on Rime announcements, summary vectors only sent when digests differ (see dtn-announce.h)
+// #define DTN_CONF_ANNOUNCE 1
+
+///Xor two bundles two neighbours are missing from each other in to one broadcast (see dtn-coding.h)
+// #define DTN_CONF_CODING 1
+
+///Size L for new bundles from the observed network size and encounter rate (see dtn-adapt.h)
+// #define DTN_CONF_ADAPT 1
+
+///Route bundles along a contact plan written to CFS by plan.sh, the rest are sprayed (see dtn-plan.h)
+// #define DTN_CONF_PLAN 1
+
+///Duty cycle the radio around beacon wake windows, needs nullrdc so nothing else turns the radio on (see dtn-duty.h)
+// #define DTN_CONF_DUTY 1
+// #define NETSTACK_CONF_RDC nullrdc_driver
+
+///Sample the sensors and send batches of readings, bundles need room for a batch (see dtn-sample.h)
+// #define DTN_CONF_SAMPLE 1
+// #define DTN_CONF_MAX_MSG_SIZE 24
+
+///Skip the cache walk for beacons that repeat a summary which needed nothing (see dtn-summary.h)
+// #define DTN_CONF_SUMMARY_CACHE 1
+
+///Routing strategy for bundles without a plan route or group (see dtn-route.h)
+// #define DTN_CONF_ROUTE DTN_ROUTE_EPIDEMIC
+
+///Runicast retransmissions and backoff adapted to each neighbour's link (see dtn-link.h)
+// #define DTN_CONF_LINK 1
+
+///Hold answers to beacons back and drop bundles overheard going to the same node (see dtn-overhear.h)
+// #define DTN_CONF_OVERHEAR 1
+// #define NULLRDC_CONF_ADDRESS_FILTER 0
+
+///Drop bundles this many seconds after they were created, a fixed address for test images (see dtn-api.h)
+// #define DTN_CONF_LIFETIME 3600
+// #define DTN_CONF_NODE_ADDR {{128, 9}}
+
+///Send bundles several neighbours are missing once in a broadcast frame (see dtn-multicast.h)
+// #define DTN_CONF_MULTICAST 1
+
+///Beacon on a control frequency and move each transfer to a data frequency (see dtn-freq.h)
+// #define DTN_CONF_FREQ 1
+
 #endif /* __PROJECT_CONF_H__ */
@@ -0,0 +1,23 @@
+/**
+ * @file cfs.h
+ * @author Archie Norman
+ * @brief Contiki's file system API on plain files, for the host simulator.
+ * Every node sees the same files, in the directory dtn-sim is run from.
+ */
+#ifndef __SIM_CFS_H__
+#define __SIM_CFS_H__
+
+typedef long cfs_offset_t;
+#define CFS_READ   1
+#define CFS_WRITE  2
+#define CFS_APPEND 4
+#define CFS_SEEK_SET 0
+#define CFS_SEEK_CUR 1
+#define CFS_SEEK_END 2
+int cfs_open(const char *name, int flags);
+void cfs_close(int fd);
+int cfs_read(int fd, void *buf, unsigned int len);
+int cfs_write(int fd, const void *buf, unsigned int len);
+cfs_offset_t cfs_seek(int fd, cfs_offset_t offset, int whence);
+
+#endif /* __SIM_CFS_H__ */
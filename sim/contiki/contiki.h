@@ -0,0 +1,117 @@
+/**
+ * @file contiki.h
+ * @author Archie Norman
+ * @brief The parts of Contiki dtn.c uses, for the host simulator. Processes
+ * are protothreads on local continuations like the real thing, timers run on
+ * the simulator's clock and every bit of state lives in the node image the
+ * simulator swaps in for each node.
+ */
+#ifndef __SIM_CONTIKI_H__
+#define __SIM_CONTIKI_H__
+#include <stdint.h>
+#include <stddef.h>
+#ifdef PROJECT_CONF_H
+#include PROJECT_CONF_H
+#endif
+
+///Milliseconds, the same tick as Contiki's native target
+typedef unsigned long clock_time_t;
+#define CLOCK_SECOND 1000UL
+clock_time_t clock_time(void);
+unsigned long clock_seconds(void);
+///Swept by the simulator, sim/Makefile points DTN_CONF_BEACON_MIN/SPREAD at them
+extern clock_time_t sim_beacon_min, sim_beacon_spread;
+
+/*---------------------------------------------------------------------------*/
+///Protothreads, local continuations on switch/case
+struct pt
+{
+	unsigned short lc;
+};
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+#define PT_THREAD(name_args) char name_args
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch((pt)->lc) { case 0:
+#define PT_END(pt) } PT_YIELD_FLAG = 0; (pt)->lc = 0; return PT_ENDED; }
+#define PT_YIELD_UNTIL(pt, cond) \
+  do { \
+    PT_YIELD_FLAG = 0; \
+    (pt)->lc = __LINE__; case __LINE__: \
+    if((PT_YIELD_FLAG == 0) || !(cond)) { \
+      return PT_YIELDED; \
+    } \
+  } while(0)
+#define PT_YIELD(pt) PT_YIELD_UNTIL(pt, 1)
+#define PT_EXIT(pt) do { (pt)->lc = 0; return PT_EXITED; } while(0)
+
+/*---------------------------------------------------------------------------*/
+typedef unsigned char process_event_t;
+typedef void *process_data_t;
+#define PROCESS_EVENT_NONE  0x80
+#define PROCESS_EVENT_INIT  0x81
+#define PROCESS_EVENT_POLL  0x82
+#define PROCESS_EVENT_EXIT  0x83
+#define PROCESS_EVENT_TIMER 0x88
+#define PROCESS_NONE NULL
+
+struct process
+{
+	struct process *next;
+	const char *name;
+	PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
+	struct pt pt;
+	unsigned char running, needspoll;
+};
+#define PROCESS_THREAD(name, ev, data) \
+  static PT_THREAD(process_thread_##name(struct pt *process_pt, process_event_t ev, process_data_t data))
+#define PROCESS_NAME(name) extern struct process name
+#define PROCESS(name, strname) \
+  PROCESS_THREAD(name, ev, data); \
+  struct process name = { NULL, strname, process_thread_##name }
+#define PROCESS_BEGIN() PT_BEGIN(process_pt)
+#define PROCESS_END() PT_END(process_pt)
+#define PROCESS_WAIT_EVENT() PROCESS_YIELD()
+#define PROCESS_WAIT_EVENT_UNTIL(c) PROCESS_YIELD_UNTIL(c)
+#define PROCESS_YIELD() PT_YIELD(process_pt)
+#define PROCESS_YIELD_UNTIL(c) PT_YIELD_UNTIL(process_pt, c)
+#define PROCESS_WAIT_UNTIL(c) PT_YIELD_UNTIL(process_pt, c)
+#define PROCESS_EXIT() PT_EXIT(process_pt)
+#define PROCESS_PAUSE() do { process_poll(PROCESS_CURRENT()); PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL); } while(0)
+#define PROCESS_EXITHANDLER(handler) if(ev == PROCESS_EVENT_EXIT) { handler; PT_EXIT(process_pt); }
+#define PROCESS_CURRENT() process_current
+extern struct process *process_current;
+void process_start(struct process *p, process_data_t data);
+void process_exit(struct process *p);
+void process_poll(struct process *p);
+int process_post(struct process *p, process_event_t ev, process_data_t data);
+
+#define AUTOSTART_PROCESSES(...) \
+  struct process * const autostart_processes[] = {__VA_ARGS__, NULL}
+
+/*---------------------------------------------------------------------------*/
+struct timer
+{
+	clock_time_t start;
+	clock_time_t interval;
+};
+void timer_set(struct timer *t, clock_time_t interval);
+void timer_reset(struct timer *t);
+void timer_restart(struct timer *t);
+int timer_expired(struct timer *t);
+clock_time_t timer_remaining(struct timer *t);
+
+struct etimer
+{
+	struct timer timer;
+	struct etimer *next;
+	struct process *p;
+};
+void etimer_set(struct etimer *et, clock_time_t interval);
+void etimer_reset(struct etimer *et);
+void etimer_restart(struct etimer *et);
+void etimer_stop(struct etimer *et);
+int etimer_expired(struct etimer *et);
+
+#endif /* __SIM_CONTIKI_H__ */
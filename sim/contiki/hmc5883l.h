@@ -0,0 +1,9 @@
+/**
+ * @file hmc5883l.h
+ * @author Archie Norman
+ * @brief The compass is not simulated.
+ */
+#ifndef __SIM_HMC5883L_H__
+#define __SIM_HMC5883L_H__
+
+#endif /* __SIM_HMC5883L_H__ */
@@ -0,0 +1,12 @@
+/**
+ * @file crc16.h
+ * @author Archie Norman
+ * @brief Contiki's CRC16, for the host simulator.
+ */
+#ifndef __SIM_CRC16_H__
+#define __SIM_CRC16_H__
+
+unsigned short crc16_add(unsigned char b, unsigned short crc);
+unsigned short crc16_data(const unsigned char *data, int datalen, unsigned short acc);
+
+#endif /* __SIM_CRC16_H__ */
@@ -0,0 +1,30 @@
+/**
+ * @file memb.h
+ * @author Archie Norman
+ * @brief Contiki's fixed size block allocator, for the host simulator.
+ */
+#ifndef __SIM_MEMB_H__
+#define __SIM_MEMB_H__
+
+#define MEMB_CONCAT2(s1, s2) s1##s2
+#define MEMB_CONCAT(s1, s2) MEMB_CONCAT2(s1, s2)
+#define MEMB(name, structure, num) \
+  static char MEMB_CONCAT(name,_memb_count)[num]; \
+  static structure MEMB_CONCAT(name,_memb_mem)[num]; \
+  static struct memb name = {sizeof(structure), num, \
+                             MEMB_CONCAT(name,_memb_count), \
+                             (void *)MEMB_CONCAT(name,_memb_mem)}
+
+struct memb
+{
+	unsigned short size;
+	unsigned short num;
+	char *count;
+	void *mem;
+};
+void memb_init(struct memb *m);
+void *memb_alloc(struct memb *m);
+char memb_free(struct memb *m, void *ptr);
+int memb_inmemb(struct memb *m, void *ptr);
+
+#endif /* __SIM_MEMB_H__ */
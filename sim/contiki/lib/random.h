@@ -0,0 +1,13 @@
+/**
+ * @file random.h
+ * @author Archie Norman
+ * @brief Contiki's random numbers, seeded per node by the host simulator.
+ */
+#ifndef __SIM_RANDOM_H__
+#define __SIM_RANDOM_H__
+
+#define RANDOM_RAND_MAX 65535U
+void random_init(unsigned short seed);
+unsigned short random_rand(void);
+
+#endif /* __SIM_RANDOM_H__ */
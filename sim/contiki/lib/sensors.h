@@ -0,0 +1,9 @@
+/**
+ * @file sensors.h
+ * @author Archie Norman
+ * @brief Nothing is sensed in the host simulator.
+ */
+#ifndef __SIM_SENSORS_H__
+#define __SIM_SENSORS_H__
+
+#endif /* __SIM_SENSORS_H__ */
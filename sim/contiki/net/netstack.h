@@ -0,0 +1,17 @@
+/**
+ * @file netstack.h
+ * @author Archie Norman
+ * @brief The radio on/off switch, for the host simulator. A node whose radio
+ * is off hears nothing and the simulator counts how long each radio was on.
+ */
+#ifndef __SIM_NETSTACK_H__
+#define __SIM_NETSTACK_H__
+
+struct radio_driver
+{
+	int (* on)(void);
+	int (* off)(void);
+};
+extern const struct radio_driver NETSTACK_RADIO;
+
+#endif /* __SIM_NETSTACK_H__ */
@@ -0,0 +1,155 @@
+/**
+ * @file rime.h
+ * @author Archie Norman
+ * @brief The Rime primitives dtn.c uses, for the host simulator. Frames are
+ * handed to the simulator's radio model instead of a MAC layer.
+ */
+#ifndef __SIM_RIME_H__
+#define __SIM_RIME_H__
+#include "contiki.h"
+#include "lib/list.h"
+
+/*---------------------------------------------------------------------------*/
+#ifndef RIMEADDR_CONF_SIZE
+#define RIMEADDR_CONF_SIZE 2
+#endif
+#define RIMEADDR_SIZE RIMEADDR_CONF_SIZE
+typedef union
+{
+	unsigned char u8[RIMEADDR_SIZE];
+}rimeaddr_t;
+extern rimeaddr_t rimeaddr_node_addr;
+extern const rimeaddr_t rimeaddr_null;
+void rimeaddr_copy(rimeaddr_t *dest, const rimeaddr_t *from);
+int rimeaddr_cmp(const rimeaddr_t *addr1, const rimeaddr_t *addr2);
+void rimeaddr_set_node_addr(rimeaddr_t *addr);
+
+/*---------------------------------------------------------------------------*/
+///Larger than a radio frame, so caches bigger than a real node holds still fit
+#ifdef PACKETBUF_CONF_SIZE
+#define PACKETBUF_SIZE PACKETBUF_CONF_SIZE
+#else
+#define PACKETBUF_SIZE 2048
+#endif
+int packetbuf_copyfrom(const void *from, uint16_t len);
+int packetbuf_copyto(void *to);
+void *packetbuf_dataptr(void);
+uint16_t packetbuf_datalen(void);
+void packetbuf_clear(void);
+///Only the attributes and addresses the protocol modules look at
+enum
+{
+	PACKETBUF_ATTR_CHANNEL,
+	PACKETBUF_ATTR_PACKET_TYPE
+};
+enum
+{
+	PACKETBUF_ATTR_PACKET_TYPE_DATA,
+	PACKETBUF_ATTR_PACKET_TYPE_ACK
+};
+enum
+{
+	PACKETBUF_ADDR_SENDER,
+	PACKETBUF_ADDR_RECEIVER
+};
+typedef uint16_t packetbuf_attr_t;
+packetbuf_attr_t packetbuf_attr(uint8_t type);
+const rimeaddr_t *packetbuf_addr(uint8_t type);
+
+/*---------------------------------------------------------------------------*/
+///Sniffers see every frame the node receives, including runicasts to other nodes
+struct rime_sniffer
+{
+	struct rime_sniffer *next;
+	void (* input_callback)(void);
+	void (* output_callback)(int mac_status);
+};
+#define RIME_SNIFFER(name, input_callback, output_callback) \
+static struct rime_sniffer name = { NULL, input_callback, output_callback }
+void rime_sniffer_add(struct rime_sniffer *s);
+
+/*---------------------------------------------------------------------------*/
+///Every connection is registered with its node so received frames find it
+struct sim_conn
+{
+	struct sim_conn *next;
+	uint16_t channel;
+	uint8_t kind;
+};
+enum
+{
+	SIM_BROADCAST = 1,
+	SIM_UNICAST,
+	SIM_RUNICAST,
+	SIM_ANNOUNCEMENT
+};
+
+struct broadcast_conn;
+struct broadcast_callbacks
+{
+	void (* recv)(struct broadcast_conn *ptr, const rimeaddr_t *sender);
+	void (* sent)(struct broadcast_conn *ptr, int status, int num_tx);
+};
+struct broadcast_conn
+{
+	struct sim_conn sim;
+	const struct broadcast_callbacks *u;
+};
+void broadcast_open(struct broadcast_conn *c, uint16_t channel, const struct broadcast_callbacks *u);
+void broadcast_close(struct broadcast_conn *c);
+int broadcast_send(struct broadcast_conn *c);
+
+struct unicast_conn;
+struct unicast_callbacks
+{
+	void (* recv)(struct unicast_conn *c, const rimeaddr_t *from);
+	void (* sent)(struct unicast_conn *ptr, int status, int num_tx);
+};
+struct unicast_conn
+{
+	struct sim_conn sim;
+	const struct unicast_callbacks *u;
+};
+void unicast_open(struct unicast_conn *c, uint16_t channel, const struct unicast_callbacks *u);
+void unicast_close(struct unicast_conn *c);
+int unicast_send(struct unicast_conn *c, const rimeaddr_t *receiver);
+
+struct runicast_conn;
+struct runicast_callbacks
+{
+	void (* recv)(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno);
+	void (* sent)(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions);
+	void (* timedout)(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions);
+};
+struct runicast_conn
+{
+	struct sim_conn sim;
+	const struct runicast_callbacks *u;
+	uint8_t sndnxt;
+	uint8_t is_tx;
+};
+void runicast_open(struct runicast_conn *c, uint16_t channel, const struct runicast_callbacks *u);
+void runicast_close(struct runicast_conn *c);
+int runicast_send(struct runicast_conn *c, const rimeaddr_t *receiver, uint8_t max_retransmissions);
+uint8_t runicast_is_transmitting(struct runicast_conn *c);
+
+/*---------------------------------------------------------------------------*/
+struct announcement;
+typedef void (*announcement_callback_t)(struct announcement *a, const rimeaddr_t *from,
+                                        uint16_t id, uint16_t val);
+struct announcement
+{
+	struct announcement *next;
+	uint16_t id;
+	uint16_t value;
+	uint8_t has_value;
+	announcement_callback_t callback;
+};
+void announcement_register(struct announcement *a, uint16_t id, announcement_callback_t callback);
+void announcement_remove(struct announcement *a);
+void announcement_set_value(struct announcement *a, uint16_t value);
+void announcement_remove_value(struct announcement *a);
+void announcement_bump(struct announcement *a);
+void announcement_listen(int periods);
+
+#endif /* __SIM_RIME_H__ */
@@ -0,0 +1,813 @@
+/**
+ * @file node.c
+ * @author Archie Norman
+ * @brief The node side of the simulator, the Contiki and Rime calls dtn.c
+ * makes. Every static in here is per node, see sim.h.
+ */
+#include "sim.h"
+#include "dtn-sim.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+#include "lib/crc16.h"
+#include "cfs/cfs.h"
+#include "net/netstack.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+///Polite announcements start at this period and back off to the max
+#define ANNOUNCE_MIN (CLOCK_SECOND * 2)
+#define ANNOUNCE_MAX (CLOCK_SECOND * 128)
+#define ANNOUNCE_MAX_VALUES 8
+
+rimeaddr_t rimeaddr_node_addr;
+const rimeaddr_t rimeaddr_null = {{0}};
+struct process *process_current;
+extern struct process * const autostart_processes[];
+
+static uint8_t packetbuf[PACKETBUF_SIZE];
+static uint16_t packetbuf_len;
+static packetbuf_attr_t packetbuf_channel;
+static rimeaddr_t packetbuf_sender, packetbuf_receiver;
+static struct rime_sniffer *sniffers;
+static struct process *process_list;
+static struct etimer *timer_list;
+static uint8_t polls;
+static struct sim_conn *conns;
+static struct announcement *announcements;
+static clock_time_t announce_interval, announce_next;
+static unsigned long random_state;
+static const struct dtn_sim_hooks *hooks;
+
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return sim_now();
+}
+unsigned long
+clock_seconds(void)
+{
+  return sim_now() / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+void
+random_init(unsigned short seed)
+{
+  random_state = seed;
+}
+unsigned short
+random_rand(void)
+{
+  ///The same linear congruential generator as Contiki's native random.c
+  random_state = random_state * 1103515245 + 12345;
+  return (unsigned short)((random_state / 65536) % 32768) << 1 | (random_state & 1);
+}
+/*---------------------------------------------------------------------------*/
+void
+rimeaddr_copy(rimeaddr_t *dest, const rimeaddr_t *src)
+{
+  memcpy(dest, src, RIMEADDR_SIZE);
+}
+int
+rimeaddr_cmp(const rimeaddr_t *addr1, const rimeaddr_t *addr2)
+{
+  return memcmp(addr1, addr2, RIMEADDR_SIZE) == 0;
+}
+void
+rimeaddr_set_node_addr(rimeaddr_t *addr)
+{
+  rimeaddr_copy(&rimeaddr_node_addr, addr);
+}
+/*---------------------------------------------------------------------------*/
+int
+packetbuf_copyfrom(const void *from, uint16_t len)
+{
+  packetbuf_len = len < PACKETBUF_SIZE ? len : PACKETBUF_SIZE;
+  memcpy(packetbuf, from, packetbuf_len);
+  return packetbuf_len;
+}
+int
+packetbuf_copyto(void *to)
+{
+  memcpy(to, packetbuf, packetbuf_len);
+  return packetbuf_len;
+}
+void *
+packetbuf_dataptr(void)
+{
+  return packetbuf;
+}
+uint16_t
+packetbuf_datalen(void)
+{
+  return packetbuf_len;
+}
+void
+packetbuf_clear(void)
+{
+  packetbuf_len = 0;
+}
+packetbuf_attr_t
+packetbuf_attr(uint8_t type)
+{
+  ///Acks are not modelled as frames, everything passed up is data
+  return type == PACKETBUF_ATTR_CHANNEL ? packetbuf_channel : PACKETBUF_ATTR_PACKET_TYPE_DATA;
+}
+const rimeaddr_t *
+packetbuf_addr(uint8_t type)
+{
+  return type == PACKETBUF_ADDR_SENDER ? &packetbuf_sender : &packetbuf_receiver;
+}
+/*---------------------------------------------------------------------------*/
+void
+rime_sniffer_add(struct rime_sniffer *s)
+{
+  s->next = sniffers;
+  sniffers = s;
+  sim_sniffing();
+}
+/*
+ * @brief Put a received frame in the packet buffer and show it to the sniffers
+ */
+static void
+input(uint16_t channel, const rimeaddr_t *from, const rimeaddr_t *to,
+      const void *data, uint16_t len)
+{
+  struct rime_sniffer *s;
+  packetbuf_copyfrom(data, len);
+  packetbuf_channel = channel;
+  rimeaddr_copy(&packetbuf_sender, from);
+  rimeaddr_copy(&packetbuf_receiver, to);
+  for(s = sniffers; s != NULL; s = s->next) {
+    if(s->input_callback != NULL) {
+      s->input_callback();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+list_init(list_t list)
+{
+  *list = NULL;
+}
+void *
+list_head(list_t list)
+{
+  return *list;
+}
+void *
+list_tail(list_t list)
+{
+  struct list *l;
+  if(*list == NULL) {
+    return NULL;
+  }
+  for(l = *list; *(void **)l != NULL; l = *(void **)l);
+  return l;
+}
+void
+list_add(list_t list, void *item)
+{
+  void **l;
+  list_remove(list, item);
+  *(void **)item = NULL;
+  for(l = list; *l != NULL; l = (void **)*l);
+  *l = item;
+}
+void
+list_push(list_t list, void *item)
+{
+  list_remove(list, item);
+  *(void **)item = *list;
+  *list = item;
+}
+void *
+list_pop(list_t list)
+{
+  void *l = *list;
+  if(l != NULL) {
+    *list = *(void **)l;
+  }
+  return l;
+}
+void *
+list_chop(list_t list)
+{
+  void *l = list_tail(list);
+  list_remove(list, l);
+  return l;
+}
+void
+list_remove(list_t list, void *item)
+{
+  void **l;
+  for(l = list; *l != NULL; l = (void **)*l) {
+    if(*l == item) {
+      *l = *(void **)item;
+      return;
+    }
+  }
+}
+int
+list_length(list_t list)
+{
+  void *l;
+  int n = 0;
+  for(l = *list; l != NULL; l = *(void **)l) {
+    n++;
+  }
+  return n;
+}
+void
+list_insert(list_t list, void *previtem, void *newitem)
+{
+  if(previtem == NULL) {
+    list_push(list, newitem);
+  }
+  else {
+    *(void **)newitem = *(void **)previtem;
+    *(void **)previtem = newitem;
+  }
+}
+void *
+list_item_next(void *item)
+{
+  return item == NULL ? NULL : *(void **)item;
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_init(struct memb *m)
+{
+  memset(m->count, 0, m->num);
+  memset(m->mem, 0, m->size * m->num);
+}
+void *
+memb_alloc(struct memb *m)
+{
+  int i;
+  for(i = 0; i < m->num; i++) {
+    if(m->count[i] == 0) {
+      m->count[i]++;
+      return (char *)m->mem + i * m->size;
+    }
+  }
+  return NULL;
+}
+char
+memb_free(struct memb *m, void *ptr)
+{
+  int i;
+  for(i = 0; i < m->num; i++) {
+    if((char *)m->mem + i * m->size == ptr) {
+      if(m->count[i] > 0) {
+        m->count[i]--;
+      }
+      return m->count[i];
+    }
+  }
+  return -1;
+}
+int
+memb_inmemb(struct memb *m, void *ptr)
+{
+  return (char *)ptr >= (char *)m->mem && (char *)ptr < (char *)m->mem + m->num * m->size;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+crc16_add(unsigned char b, unsigned short acc)
+{
+  acc ^= b;
+  acc = (acc >> 8) | (acc << 8);
+  acc ^= (acc & 0xff00) << 4;
+  acc ^= (acc >> 8) >> 4;
+  acc ^= (acc & 0xff00) >> 5;
+  return acc;
+}
+unsigned short
+crc16_data(const unsigned char *data, int len, unsigned short acc)
+{
+  int i;
+  for(i = 0; i < len; i++) {
+    acc = crc16_add(data[i], acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+void
+timer_set(struct timer *t, clock_time_t interval)
+{
+  t->interval = interval;
+  t->start = clock_time();
+}
+void
+timer_reset(struct timer *t)
+{
+  t->start += t->interval;
+}
+void
+timer_restart(struct timer *t)
+{
+  t->start = clock_time();
+}
+int
+timer_expired(struct timer *t)
+{
+  return (clock_time_t)(clock_time() - t->start) >= t->interval;
+}
+clock_time_t
+timer_remaining(struct timer *t)
+{
+  return t->start + t->interval - clock_time();
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_open(const char *name, int flags)
+{
+  int mode = flags & CFS_WRITE ? (flags & CFS_READ ? O_RDWR : O_WRONLY) | O_CREAT : O_RDONLY;
+  if(flags & CFS_APPEND) {
+    mode = O_WRONLY | O_CREAT | O_APPEND;
+  }
+  return open(name, mode, 0644);
+}
+void
+cfs_close(int fd)
+{
+  close(fd);
+}
+int
+cfs_read(int fd, void *buf, unsigned int len)
+{
+  return read(fd, buf, len);
+}
+int
+cfs_write(int fd, const void *buf, unsigned int len)
+{
+  return write(fd, buf, len);
+}
+cfs_offset_t
+cfs_seek(int fd, cfs_offset_t offset, int whence)
+{
+  return lseek(fd, offset, whence == CFS_SEEK_SET ? SEEK_SET : whence == CFS_SEEK_CUR ? SEEK_CUR : SEEK_END);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *et)
+{
+  struct etimer *t;
+  et->p = process_current;
+  for(t = timer_list; t != NULL; t = t->next) {
+    if(t == et) {
+      return;
+    }
+  }
+  et->next = timer_list;
+  timer_list = et;
+}
+static void
+remove_timer(struct etimer *et)
+{
+  struct etimer **t;
+  for(t = &timer_list; *t != NULL; t = &(*t)->next) {
+    if(*t == et) {
+      *t = et->next;
+      break;
+    }
+  }
+  et->p = PROCESS_NONE;
+}
+void
+etimer_set(struct etimer *et, clock_time_t interval)
+{
+  timer_set(&et->timer, interval);
+  add_timer(et);
+}
+void
+etimer_reset(struct etimer *et)
+{
+  timer_reset(&et->timer);
+  add_timer(et);
+}
+void
+etimer_restart(struct etimer *et)
+{
+  timer_restart(&et->timer);
+  add_timer(et);
+}
+void
+etimer_stop(struct etimer *et)
+{
+  remove_timer(et);
+}
+int
+etimer_expired(struct etimer *et)
+{
+  return et->p == PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+call_process(struct process *p, process_event_t ev, process_data_t data)
+{
+  struct process *caller = process_current;
+  char ret;
+  if(!p->running) {
+    return;
+  }
+  process_current = p;
+  ret = p->thread(&p->pt, ev, data);
+  if(ret == PT_EXITED || ret == PT_ENDED) {
+    process_exit(p);
+  }
+  process_current = caller;
+}
+void
+process_start(struct process *p, process_data_t data)
+{
+  struct process *q;
+  for(q = process_list; q != NULL; q = q->next) {
+    if(q == p) {
+      return;
+    }
+  }
+  p->next = process_list;
+  process_list = p;
+  p->running = 1;
+  p->needspoll = 0;
+  p->pt.lc = 0;
+  call_process(p, PROCESS_EVENT_INIT, data);
+}
+void
+process_exit(struct process *p)
+{
+  struct process **q;
+  struct etimer *t, *next;
+  if(!p->running) {
+    return;
+  }
+  p->running = 0;
+  for(q = &process_list; *q != NULL; q = &(*q)->next) {
+    if(*q == p) {
+      *q = p->next;
+      break;
+    }
+  }
+  for(t = timer_list; t != NULL; t = next) {
+    next = t->next;
+    if(t->p == p) {
+      remove_timer(t);
+    }
+  }
+}
+void
+process_poll(struct process *p)
+{
+  if(p != NULL) {
+    p->needspoll = 1;
+    polls = 1;
+  }
+}
+int
+process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  ///Delivered straight away, nothing in dtn.c depends on the queueing
+  call_process(p, ev, data);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct sim_conn *
+find_conn(uint8_t kind, uint16_t channel)
+{
+  struct sim_conn *c;
+  for(c = conns; c != NULL; c = c->next) {
+    if(c->kind == kind && c->channel == channel) {
+      return c;
+    }
+  }
+  return NULL;
+}
+static void
+open_conn(struct sim_conn *c, uint8_t kind, uint16_t channel)
+{
+  struct sim_conn *o;
+  c->kind = kind;
+  c->channel = channel;
+  for(o = conns; o != NULL; o = o->next) {
+    if(o == c) {
+      return;
+    }
+  }
+  c->next = conns;
+  conns = c;
+}
+static void
+close_conn(struct sim_conn *c)
+{
+  struct sim_conn **o;
+  for(o = &conns; *o != NULL; o = &(*o)->next) {
+    if(*o == c) {
+      *o = c->next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+broadcast_open(struct broadcast_conn *c, uint16_t channel, const struct broadcast_callbacks *u)
+{
+  c->u = u;
+  open_conn(&c->sim, SIM_BROADCAST, channel);
+}
+void
+broadcast_close(struct broadcast_conn *c)
+{
+  close_conn(&c->sim);
+}
+int
+broadcast_send(struct broadcast_conn *c)
+{
+  sim_radio_send(SIM_BROADCAST, &c->sim, NULL, packetbuf, packetbuf_len, 0);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+unicast_open(struct unicast_conn *c, uint16_t channel, const struct unicast_callbacks *u)
+{
+  c->u = u;
+  open_conn(&c->sim, SIM_UNICAST, channel);
+}
+void
+unicast_close(struct unicast_conn *c)
+{
+  close_conn(&c->sim);
+}
+int
+unicast_send(struct unicast_conn *c, const rimeaddr_t *receiver)
+{
+  sim_radio_send(SIM_UNICAST, &c->sim, receiver, packetbuf, packetbuf_len, 0);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+runicast_open(struct runicast_conn *c, uint16_t channel, const struct runicast_callbacks *u)
+{
+  c->u = u;
+  c->is_tx = 0;
+  open_conn(&c->sim, SIM_RUNICAST, channel);
+}
+void
+runicast_close(struct runicast_conn *c)
+{
+  close_conn(&c->sim);
+}
+int
+runicast_send(struct runicast_conn *c, const rimeaddr_t *receiver, uint8_t max_retransmissions)
+{
+  if(c->is_tx) {
+    return 0;
+  }
+  c->is_tx = 1;
+  c->sndnxt++;
+  sim_radio_send(SIM_RUNICAST, &c->sim, receiver, packetbuf, packetbuf_len, max_retransmissions);
+  return 1;
+}
+uint8_t
+runicast_is_transmitting(struct runicast_conn *c)
+{
+  return c->is_tx;
+}
+/*---------------------------------------------------------------------------*/
+void
+announcement_register(struct announcement *a, uint16_t id, announcement_callback_t callback)
+{
+  a->id = id;
+  a->has_value = 0;
+  a->callback = callback;
+  a->next = announcements;
+  announcements = a;
+  announcement_bump(a);
+}
+void
+announcement_remove(struct announcement *a)
+{
+  struct announcement **o;
+  for(o = &announcements; *o != NULL; o = &(*o)->next) {
+    if(*o == a) {
+      *o = a->next;
+      return;
+    }
+  }
+}
+void
+announcement_set_value(struct announcement *a, uint16_t value)
+{
+  a->value = value;
+  a->has_value = 1;
+}
+void
+announcement_remove_value(struct announcement *a)
+{
+  a->has_value = 0;
+}
+void
+announcement_bump(struct announcement *a)
+{
+  announce_interval = ANNOUNCE_MIN;
+  announce_next = clock_time() + random_rand() % ANNOUNCE_MIN;
+}
+void
+announcement_listen(int periods)
+{
+}
+/*
+ * @brief Send our announcement values when they are due, backing off like
+ * Rime's polite announcements
+ */
+static void
+announce(void)
+{
+  struct announcement *a;
+  uint16_t values[ANNOUNCE_MAX_VALUES * 2];
+  int n = 0;
+  if(announcements == NULL || clock_time() < announce_next) {
+    return;
+  }
+  for(a = announcements; a != NULL && n < ANNOUNCE_MAX_VALUES; a = a->next) {
+    if(a->has_value) {
+      values[n * 2] = a->id;
+      values[n * 2 + 1] = a->value;
+      n++;
+    }
+  }
+  if(n > 0) {
+    sim_radio_send(SIM_ANNOUNCEMENT, NULL, NULL, values, n * 2 * sizeof(uint16_t), 0);
+  }
+  if(announce_interval < ANNOUNCE_MAX) {
+    announce_interval *= 2;
+  }
+  announce_next = clock_time() + announce_interval / 2 + random_rand() % (announce_interval / 2);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_on(void)
+{
+  sim_radio_power(1);
+  return 1;
+}
+static int
+radio_off(void)
+{
+  sim_radio_power(0);
+  return 1;
+}
+const struct radio_driver NETSTACK_RADIO = {radio_on, radio_off};
+/*---------------------------------------------------------------------------*/
+void
+dtn_sim_start(const struct dtn_sim_hooks *h)
+{
+  rimeaddr_t addr;
+  hooks = h;
+  sim_addr(sim_current(), &addr);
+  rimeaddr_set_node_addr(&addr);
+}
+void
+dtn_sim_delivered(const dtn_message *message)
+{
+  sim_delivered(message);
+}
+void
+dtn_sim_frequency(uint8_t freq)
+{
+  sim_radio_frequency(freq);
+}
+/*---------------------------------------------------------------------------*/
+void
+node_boot(uint16_t node, unsigned short seed)
+{
+  int i;
+  random_init(seed);
+  announce_interval = ANNOUNCE_MIN;
+  announce_next = SIM_NEVER;
+  for(i = 0; autostart_processes[i] != NULL; i++) {
+    process_start(autostart_processes[i], NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+node_run(void)
+{
+  struct etimer *t;
+  struct process *p;
+  clock_time_t next;
+  int fired;
+
+  do {
+    fired = 0;
+    while(polls) {
+      polls = 0;
+      for(p = process_list; p != NULL; p = p->next) {
+        if(p->needspoll) {
+          p->needspoll = 0;
+          call_process(p, PROCESS_EVENT_POLL, NULL);
+          fired = 1;
+          break;
+        }
+      }
+      if(p != NULL) {
+        polls = 1;
+      }
+    }
+    for(t = timer_list; t != NULL; t = t->next) {
+      if(timer_expired(&t->timer)) {
+        p = t->p;
+        remove_timer(t);
+        call_process(p, PROCESS_EVENT_TIMER, t);
+        fired = 1;
+        break;
+      }
+    }
+  } while(fired);
+  announce();
+
+  next = announcements != NULL ? announce_next : SIM_NEVER;
+  for(t = timer_list; t != NULL; t = t->next) {
+    if(t->timer.start + t->timer.interval < next) {
+      next = t->timer.start + t->timer.interval;
+    }
+  }
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+void
+node_receive(uint8_t kind, uint16_t channel, const rimeaddr_t *from,
+             const void *data, uint16_t len, uint8_t seqno)
+{
+  struct sim_conn *c;
+  struct announcement *a;
+  const uint16_t *values;
+  int i;
+
+  if(kind == SIM_ANNOUNCEMENT) {
+    values = data;
+    for(i = 0; i < (int)(len / (2 * sizeof(uint16_t))); i++) {
+      for(a = announcements; a != NULL; a = a->next) {
+        if(a->callback != NULL) {
+          a->callback(a, from, values[i * 2], values[i * 2 + 1]);
+        }
+      }
+    }
+    return;
+  }
+  input(channel, from, kind == SIM_BROADCAST ? &rimeaddr_null : &rimeaddr_node_addr, data, len);
+  c = find_conn(kind, channel);
+  if(c == NULL) {
+    return;
+  }
+  if(kind == SIM_BROADCAST) {
+    ((struct broadcast_conn *)c)->u->recv((struct broadcast_conn *)c, from);
+  }
+  else if(kind == SIM_UNICAST) {
+    ((struct unicast_conn *)c)->u->recv((struct unicast_conn *)c, from);
+  }
+  else if(kind == SIM_RUNICAST) {
+    ((struct runicast_conn *)c)->u->recv((struct runicast_conn *)c, from, seqno);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+node_overhear(uint16_t channel, const rimeaddr_t *from, const rimeaddr_t *to,
+              const void *data, uint16_t len)
+{
+  input(channel, from, to, data, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+node_runicast_done(struct sim_conn *conn, const rimeaddr_t *to, int acked, uint8_t retransmissions)
+{
+  struct runicast_conn *c = (struct runicast_conn *)conn;
+  c->is_tx = 0;
+  if(acked) {
+    if(c->u->sent != NULL) {
+      c->u->sent(c, to, retransmissions);
+    }
+  }
+  else if(c->u->timedout != NULL) {
+    c->u->timedout(c, to, retransmissions);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+node_create(const rimeaddr_t *dest, uint8_t copies)
+{
+  if(hooks != NULL) {
+    hooks->create(dest, copies);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+node_counters(int *unicasts, int *acks, int *timeouts)
+{
+  *unicasts = hooks ? *hooks->unicasts : 0;
+  *acks = hooks ? *hooks->acks : 0;
+  *timeouts = hooks ? *hooks->timeouts : 0;
+}
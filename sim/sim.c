@@ -0,0 +1,1036 @@
+/**
+ * @file sim.c
+ * @author Archie Norman
+ * @brief Host simulator for the DTN protocol. Runs dtn.c and the protocol
+ * modules on thousands of nodes against a unit disk radio model, with random
+ * waypoint, static or trace driven mobility. Every sweep point is simulated
+ * in its own worker process, as many at once as there are cores, and each
+ * point's seed is derived from the base seed and its index so a sweep gives
+ * the same numbers however many workers run it.
+ *
+ * Usage: ./dtn-sim [options] [-S name=v1,v2,...]...
+ *   -n nodes       number of nodes (at most 24576)
+ *   -t seconds     simulated time
+ *   -b bundles     bundles created, at random times before -c seconds
+ *   -c seconds     bundles are created up to this time (default -t / 2)
+ *   -L copies      copies each bundle starts with
+ *   -a metres      side of the square area
+ *   -r metres      radio range
+ *   -p loss        probability a frame is lost, per receiver
+ *   -v min:max     random waypoint speed in m/s
+ *   -w seconds     random waypoint pause
+ *   -B min:spread  beacon interval in seconds
+ *   -m model       rwp, static or trace:FILE ("time node x y" lines)
+ *   -s seed        base seed
+ *   -R reps        repetitions of every sweep point
+ *   -j jobs        worker processes (default the number of cores)
+ *   -o dir         where the per point logs are written (default sim-out)
+ *   -C             frames that overlap at a receiver on the same frequency
+ *                  collide, only the first to end gets through
+ *   -S name=list   sweep a parameter, e.g. -S L=1,2,4,8 -S beacon=2:5,10:10,
+ *                  several -S give every combination
+ *
+ * Each point's log, point-N.log, holds the usual [MSG-CRT]/[RCV-RCH] records
+ * so extract.sh and the existing analysis work on it, followed by a
+ * [SIM-STATS] line. The [SIM-CONF]/[SIM-STATS] lines of every point are also
+ * printed here, in point order.
+ */
+#define _GNU_SOURCE
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MAX_NODES (96 * 256)
+#define MAX_SWEEPS 8
+#define MAX_SWEEP_VALUES 32
+///How often the neighbour grid is rebuilt, nodes move at most vmax times this between rebuilds
+#define GRID_PERIOD CLOCK_SECOND
+///Rime's runicast retransmission time
+#define REXMIT_TIME CLOCK_SECOND
+
+clock_time_t sim_beacon_min = CLOCK_SECOND * 2;
+clock_time_t sim_beacon_spread = CLOCK_SECOND * 5;
+
+///The node image, see sim.h
+extern char __start_dtn_node_data[], __stop_dtn_node_data[];
+extern char __start_dtn_node_bss[], __stop_dtn_node_bss[];
+
+enum
+{
+	MOBILITY_RWP,
+	MOBILITY_STATIC,
+	MOBILITY_TRACE
+};
+struct params
+{
+	int nodes;
+	double duration;
+	int bundles;
+	double create_until;
+	int copies;
+	double area;
+	double range;
+	double loss;
+	double vmin, vmax;
+	double pause;
+	double beacon_min, beacon_spread;
+	int mobility;
+	char trace[256];
+	unsigned long long seed;
+	int collisions;
+};
+struct stats
+{
+	int created;
+	int delivered;
+	int duplicates;
+	double latency_mean, latency_p50, latency_p95;
+	long frames[SIM_ANNOUNCEMENT + 1];
+	long unicasts, acks, timeouts;
+	///Share of the time radios were on
+	double radio_on;
+	///Frames lost to another frame on the same frequency
+	long collisions;
+};
+/*---------------------------------------------------------------------------*/
+///A frame on the air, shared by every receiver
+struct frame
+{
+	int refs;
+	uint8_t kind;
+	uint16_t channel;
+	uint16_t from;
+	uint8_t seqno;
+	///The sender's frequency and when the frame, or this runicast attempt, went on the air
+	uint8_t freq;
+	clock_time_t start;
+	uint16_t len;
+	uint8_t data[];
+};
+///A runicast waiting for its ack
+struct tx
+{
+	struct frame *frame;
+	struct sim_conn *conn;
+	rimeaddr_t to;
+	uint8_t attempts;
+	uint8_t max_retransmissions;
+	///Got through before, only the ack was lost
+	uint8_t delivered;
+};
+enum
+{
+	EV_WAKE,
+	EV_RX,
+	EV_RUNICAST,
+	EV_CREATE
+};
+struct event
+{
+	clock_time_t time;
+	unsigned long seq;
+	uint8_t type;
+	uint16_t node;
+	uint16_t peer;
+	void *ptr;
+};
+/*---------------------------------------------------------------------------*/
+struct trace_point
+{
+	double t, x, y;
+};
+struct node
+{
+	///Saved .data and .bss while another node is swapped in
+	char *image;
+	clock_time_t wake;
+	///Random waypoint leg, or the trace cursor
+	double x0, y0, x1, y1, t0, t1;
+	unsigned long long rng;
+	struct trace_point *trace;
+	int trace_len, trace_at;
+	///Bundles created here, mirrors the sequence number in create_message()
+	uint8_t seq;
+	uint8_t radio_off;
+	clock_time_t radio_since, radio_on;
+	///Has a Rime sniffer, so runicasts to its neighbours are passed up too
+	uint8_t sniffing;
+	///The frequency it is tuned to, all nodes start on the same one
+	uint8_t freq;
+	///When the last frame it heard ended and on which frequency, for collisions
+	clock_time_t rx_until;
+	uint8_t rx_freq;
+};
+struct bundle
+{
+	clock_time_t created;
+	uint8_t delivered;
+};
+
+static struct params P;
+static struct stats S;
+static struct node *nodes;
+static int current = -1;
+static size_t data_size, bss_size;
+static char *pristine;
+static clock_time_t now;
+static struct event *heap;
+static int heap_len, heap_cap;
+static unsigned long event_seq;
+static unsigned long long traffic_rng;
+///Losses of overheard frames, drawn apart so sniffing does not change the traffic
+static unsigned long long overhear_rng;
+static int sniffing_nodes;
+static struct bundle *bundles;
+///Bundle index by source node and sequence number
+static int *bundle_by_key;
+static double *latencies;
+static int grid_cells;
+static double grid_size;
+static int *grid_head, *grid_next;
+static clock_time_t grid_time = SIM_NEVER;
+static double trace_vmax;
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+splitmix(unsigned long long *s)
+{
+  unsigned long long z = (*s += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+static double
+urand(unsigned long long *s)
+{
+  return (splitmix(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+swap_in(int n)
+{
+  if(n == current) {
+    return;
+  }
+  if(current >= 0) {
+    memcpy(nodes[current].image, __start_dtn_node_data, data_size);
+    memcpy(nodes[current].image + data_size, __start_dtn_node_bss, bss_size);
+  }
+  memcpy(__start_dtn_node_data, nodes[n].image, data_size);
+  memcpy(__start_dtn_node_bss, nodes[n].image + data_size, bss_size);
+  current = n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+push(clock_time_t time, uint8_t type, int node, int peer, void *ptr)
+{
+  struct event e = {time, event_seq++, type, node, peer, ptr};
+  int i, parent;
+  if(heap_len == heap_cap) {
+    heap_cap = heap_cap ? heap_cap * 2 : 1024;
+    heap = realloc(heap, heap_cap * sizeof(struct event));
+  }
+  for(i = heap_len++; i > 0; i = parent) {
+    parent = (i - 1) / 2;
+    if(heap[parent].time < e.time || (heap[parent].time == e.time && heap[parent].seq < e.seq)) {
+      break;
+    }
+    heap[i] = heap[parent];
+  }
+  heap[i] = e;
+}
+static struct event
+pop(void)
+{
+  struct event top = heap[0], last = heap[--heap_len];
+  int i = 0, child;
+  while((child = 2 * i + 1) < heap_len) {
+    if(child + 1 < heap_len && (heap[child + 1].time < heap[child].time ||
+       (heap[child + 1].time == heap[child].time && heap[child + 1].seq < heap[child].seq))) {
+      child++;
+    }
+    if(last.time < heap[child].time || (last.time == heap[child].time && last.seq < heap[child].seq)) {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = last;
+  return top;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * @brief Run whatever the swapped in node has due and reschedule its wake up
+ */
+static void
+run_node(int n)
+{
+  clock_time_t next = node_run();
+  if(next < now) {
+    next = now;
+  }
+  if(next != nodes[n].wake) {
+    nodes[n].wake = next;
+    if(next != SIM_NEVER) {
+      push(next, EV_WAKE, n, 0, NULL);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * @brief Where a node is at the current time, legs are only ever moved forward
+ */
+static void
+position(int n, double *x, double *y)
+{
+  struct node *node = &nodes[n];
+  double t = now / (double)CLOCK_SECOND, f, d;
+  if(P.mobility == MOBILITY_STATIC) {
+    *x = node->x0;
+    *y = node->y0;
+    return;
+  }
+  if(P.mobility == MOBILITY_TRACE) {
+    while(node->trace_at + 1 < node->trace_len && node->trace[node->trace_at + 1].t <= t) {
+      node->trace_at++;
+    }
+    if(node->trace_len == 0) {
+      *x = *y = 0;
+    }
+    else if(node->trace_at + 1 == node->trace_len || t <= node->trace[node->trace_at].t) {
+      *x = node->trace[node->trace_at].x;
+      *y = node->trace[node->trace_at].y;
+    }
+    else {
+      struct trace_point *a = &node->trace[node->trace_at], *b = a + 1;
+      f = (t - a->t) / (b->t - a->t);
+      *x = a->x + (b->x - a->x) * f;
+      *y = a->y + (b->y - a->y) * f;
+    }
+    return;
+  }
+  ///Random waypoint, a new leg starts once the pause after the last one is over
+  while(t >= node->t1 + P.pause) {
+    node->t0 = node->t1 + P.pause;
+    node->x0 = node->x1;
+    node->y0 = node->y1;
+    node->x1 = urand(&node->rng) * P.area;
+    node->y1 = urand(&node->rng) * P.area;
+    d = hypot(node->x1 - node->x0, node->y1 - node->y0);
+    node->t1 = node->t0 + d / (P.vmin + urand(&node->rng) * (P.vmax - P.vmin));
+  }
+  f = t <= node->t0 ? 0 : t >= node->t1 ? 1 : (t - node->t0) / (node->t1 - node->t0);
+  *x = node->x0 + (node->x1 - node->x0) * f;
+  *y = node->y0 + (node->y1 - node->y0) * f;
+}
+/*---------------------------------------------------------------------------*/
+static int
+cell_of(double v)
+{
+  int c = (int)(v / grid_size);
+  return c < 0 ? 0 : c >= grid_cells ? grid_cells - 1 : c;
+}
+/*
+ * @brief Bucket the nodes in cells big enough that anyone in range before the
+ * next rebuild is in a neighbouring cell now
+ */
+static void
+build_grid(void)
+{
+  int i, c;
+  double x, y;
+  grid_time = now - now % GRID_PERIOD;
+  for(i = 0; i < grid_cells * grid_cells; i++) {
+    grid_head[i] = -1;
+  }
+  for(i = 0; i < P.nodes; i++) {
+    position(i, &x, &y);
+    c = cell_of(y) * grid_cells + cell_of(x);
+    grid_next[i] = grid_head[c];
+    grid_head[c] = i;
+  }
+}
+/*
+ * @brief Collect the nodes in range of a node
+ * @return the number found
+ */
+static int
+neighbours(int n, int *out)
+{
+  int cx, cy, gx, gy, i, found = 0;
+  double x, y, nx, ny;
+  if(grid_time == SIM_NEVER || now >= grid_time + GRID_PERIOD) {
+    build_grid();
+  }
+  position(n, &x, &y);
+  cx = cell_of(x);
+  cy = cell_of(y);
+  for(gy = cy - 1; gy <= cy + 1; gy++) {
+    for(gx = cx - 1; gx <= cx + 1; gx++) {
+      if(gx < 0 || gy < 0 || gx >= grid_cells || gy >= grid_cells) {
+        continue;
+      }
+      for(i = grid_head[gy * grid_cells + gx]; i >= 0; i = grid_next[i]) {
+        if(i == n) {
+          continue;
+        }
+        position(i, &nx, &ny);
+        if(hypot(nx - x, ny - y) <= P.range) {
+          out[found++] = i;
+        }
+      }
+    }
+  }
+  return found;
+}
+static int
+in_range(int a, int b)
+{
+  double ax, ay, bx, by;
+  position(a, &ax, &ay);
+  position(b, &bx, &by);
+  return hypot(ax - bx, ay - by) <= P.range;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_addr(uint16_t node, rimeaddr_t *addr)
+{
+  rimeaddr_copy(addr, &rimeaddr_null);
+  addr->u8[0] = 128 + node / 256;
+  addr->u8[1] = node % 256;
+}
+static int
+addr_node(const rimeaddr_t *addr)
+{
+  int n = (addr->u8[0] - 128) * 256 + addr->u8[1];
+  return addr->u8[0] >= 128 && n < P.nodes ? n : -1;
+}
+clock_time_t
+sim_now(void)
+{
+  return now;
+}
+uint16_t
+sim_current(void)
+{
+  return current;
+}
+/*---------------------------------------------------------------------------*/
+///Airtime at 250 kbps, a millisecond for the preamble and headers
+static clock_time_t
+airtime(uint16_t len)
+{
+  return 1 + len / 32;
+}
+/*
+ * @brief Whether a node's radio is on and tuned to the frame's frequency
+ */
+static int
+tuned(int m, const struct frame *f)
+{
+  return !nodes[m].radio_off && nodes[m].freq == f->freq;
+}
+/*
+ * @brief Whether a frame ending now gets through to a node that hears it.
+ * With collisions on it is lost if another frame on the same frequency was
+ * still arriving when it started, either way the node is busy until now.
+ */
+static int
+clear(int m, const struct frame *f)
+{
+  struct node *node = &nodes[m];
+  int collided;
+  if(!P.collisions) {
+    return 1;
+  }
+  collided = node->rx_freq == f->freq && node->rx_until > f->start;
+  node->rx_freq = f->freq;
+  node->rx_until = now;
+  if(collided) {
+    S.collisions++;
+  }
+  return !collided;
+}
+static void
+release(struct frame *f)
+{
+  if(--f->refs == 0) {
+    free(f);
+  }
+}
+void
+sim_radio_send(uint8_t kind, struct sim_conn *conn, const rimeaddr_t *to,
+               const void *data, uint16_t len, uint8_t max_retransmissions)
+{
+  static int *found;
+  struct frame *f = malloc(sizeof(struct frame) + len);
+  struct tx *tx;
+  int i, n, dest;
+
+  f->refs = 1;
+  f->kind = kind;
+  f->channel = conn != NULL ? conn->channel : 0;
+  f->from = current;
+  f->seqno = kind == SIM_RUNICAST ? ((struct runicast_conn *)conn)->sndnxt : 0;
+  f->freq = nodes[current].freq;
+  f->start = now;
+  f->len = len;
+  memcpy(f->data, data, len);
+  S.frames[kind]++;
+
+  if(kind == SIM_RUNICAST) {
+    tx = malloc(sizeof(struct tx));
+    tx->frame = f;
+    tx->conn = conn;
+    rimeaddr_copy(&tx->to, to);
+    tx->attempts = 0;
+    tx->delivered = 0;
+    tx->max_retransmissions = max_retransmissions;
+    push(now + airtime(len), EV_RUNICAST, current, 0, tx);
+    return;
+  }
+  if(kind == SIM_UNICAST) {
+    dest = addr_node(to);
+    if(dest >= 0 && in_range(current, dest) && urand(&traffic_rng) >= P.loss) {
+      f->refs++;
+      push(now + airtime(len), EV_RX, dest, 0, f);
+    }
+    release(f);
+    return;
+  }
+  if(found == NULL) {
+    found = malloc(MAX_NODES * sizeof(int));
+  }
+  n = neighbours(current, found);
+  for(i = 0; i < n; i++) {
+    if(urand(&traffic_rng) >= P.loss) {
+      f->refs++;
+      push(now + airtime(len), EV_RX, found[i], 0, f);
+    }
+  }
+  release(f);
+}
+/*
+ * @brief One runicast attempt, the frame and its ack both have to get through.
+ * A frame whose ack was lost is not handed up again on the retransmissions.
+ */
+static void
+runicast_attempt(int n, struct tx *tx)
+{
+  static int *found;
+  int dest = addr_node(&tx->to), acked = 0, i, m;
+  rimeaddr_t from;
+  ///Every attempt is on the air, neighbours with a sniffer may hear it
+  if(found == NULL) {
+    found = malloc(MAX_NODES * sizeof(int));
+  }
+  tx->frame->start = now - airtime(tx->frame->len);
+  sim_addr(n, &from);
+  for(i = sniffing_nodes > 0 ? neighbours(n, found) - 1 : -1; i >= 0; i--) {
+    m = found[i];
+    if(m != dest && nodes[m].sniffing && tuned(m, tx->frame) && urand(&overhear_rng) >= P.loss) {
+      swap_in(m);
+      node_overhear(tx->frame->channel, &from, &tx->to, tx->frame->data, tx->frame->len);
+      run_node(m);
+    }
+  }
+  if(dest >= 0 && tuned(dest, tx->frame) && in_range(n, dest) && urand(&traffic_rng) >= P.loss &&
+     clear(dest, tx->frame)) {
+    if(!tx->delivered) {
+      tx->delivered = 1;
+      sim_addr(n, &from);
+      swap_in(dest);
+      node_receive(SIM_RUNICAST, tx->frame->channel, &from,
+                   tx->frame->data, tx->frame->len, tx->frame->seqno);
+      run_node(dest);
+    }
+    ///The sender has to be on the same frequency for the ack
+    acked = tuned(n, tx->frame) && urand(&traffic_rng) >= P.loss;
+  }
+  if(acked || tx->attempts >= tx->max_retransmissions) {
+    swap_in(n);
+    node_runicast_done(tx->conn, &tx->to, acked, tx->attempts);
+    run_node(n);
+    release(tx->frame);
+    free(tx);
+    return;
+  }
+  tx->attempts++;
+  S.frames[SIM_RUNICAST]++;
+  push(now + REXMIT_TIME + airtime(tx->frame->len), EV_RUNICAST, n, 0, tx);
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_radio_power(int on)
+{
+  struct node *node = &nodes[current];
+  if(on == !node->radio_off) {
+    return;
+  }
+  if(!on) {
+    node->radio_on += now - node->radio_since;
+  }
+  node->radio_since = now;
+  node->radio_off = !on;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_radio_frequency(uint8_t freq)
+{
+  nodes[current].freq = freq;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_sniffing(void)
+{
+  if(!nodes[current].sniffing) {
+    nodes[current].sniffing = 1;
+    sniffing_nodes++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_delivered(const dtn_message *message)
+{
+  int src = addr_node(&message->hdr.message_id.src), b;
+  if(src < 0 || (b = bundle_by_key[src * 256 + message->hdr.message_id.seq]) < 0) {
+    return;
+  }
+  if(bundles[b].delivered) {
+    S.duplicates++;
+    return;
+  }
+  bundles[b].delivered = 1;
+  latencies[S.delivered++] = (now - bundles[b].created) / (double)CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static int
+cmp_double(const void *a, const void *b)
+{
+  double d = *(const double *)a - *(const double *)b;
+  return d < 0 ? -1 : d > 0;
+}
+static int
+load_trace(void)
+{
+  FILE *f = fopen(P.trace, "r");
+  struct trace_point p;
+  struct node *node;
+  double d, dt;
+  int n, i, k;
+  if(f == NULL) {
+    perror(P.trace);
+    return 0;
+  }
+  while(fscanf(f, "%lf %d %lf %lf", &p.t, &n, &p.x, &p.y) == 4) {
+    if(n < 0 || n >= P.nodes) {
+      continue;
+    }
+    node = &nodes[n];
+    node->trace = realloc(node->trace, (node->trace_len + 1) * sizeof(struct trace_point));
+    ///Keep each node's points in time order
+    for(k = node->trace_len; k > 0 && node->trace[k - 1].t > p.t; k--) {
+      node->trace[k] = node->trace[k - 1];
+    }
+    node->trace[k] = p;
+    node->trace_len++;
+  }
+  fclose(f);
+  trace_vmax = 0;
+  for(n = 0; n < P.nodes; n++) {
+    for(i = 1; i < nodes[n].trace_len; i++) {
+      d = hypot(nodes[n].trace[i].x - nodes[n].trace[i - 1].x, nodes[n].trace[i].y - nodes[n].trace[i - 1].y);
+      dt = nodes[n].trace[i].t - nodes[n].trace[i - 1].t;
+      if(dt > 0 && d / dt > trace_vmax) {
+        trace_vmax = d / dt;
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * @brief Simulate one sweep point, the node records go to stdout
+ */
+static int
+simulate(void)
+{
+  unsigned long long rng = P.seed;
+  clock_time_t end = P.duration * CLOCK_SECOND, create_until;
+  struct event e;
+  struct node *node;
+  int i, src, dest, unicasts, acks, timeouts;
+  double vmax;
+
+  memset(&S, 0, sizeof(S));
+  sniffing_nodes = 0;
+  sim_beacon_min = P.beacon_min * CLOCK_SECOND;
+  sim_beacon_spread = P.beacon_spread * CLOCK_SECOND;
+  if(sim_beacon_spread == 0) {
+    sim_beacon_spread = 1;
+  }
+  nodes = calloc(P.nodes, sizeof(struct node));
+  if(P.mobility == MOBILITY_TRACE && !load_trace()) {
+    return 0;
+  }
+  vmax = P.mobility == MOBILITY_RWP ? P.vmax : P.mobility == MOBILITY_TRACE ? trace_vmax : 0;
+  grid_size = P.range + 2 * vmax * GRID_PERIOD / CLOCK_SECOND;
+  grid_cells = (int)ceil(P.area / grid_size);
+  if(grid_cells < 1) {
+    grid_cells = 1;
+  }
+  grid_head = malloc(grid_cells * grid_cells * sizeof(int));
+  grid_next = malloc(P.nodes * sizeof(int));
+
+  ///Every node starts from the image the program was loaded with
+  for(i = 0; i < P.nodes; i++) {
+    node = &nodes[i];
+    node->image = malloc(data_size + bss_size);
+    memcpy(node->image, pristine, data_size);
+    memset(node->image + data_size, 0, bss_size);
+    node->rng = splitmix(&rng);
+    node->x0 = node->x1 = urand(&node->rng) * P.area;
+    node->y0 = node->y1 = urand(&node->rng) * P.area;
+    node->t0 = node->t1 = -P.pause;
+    node->wake = SIM_NEVER;
+  }
+  for(i = 0; i < P.nodes; i++) {
+    swap_in(i);
+    node_boot(i, (unsigned short)splitmix(&rng));
+    run_node(i);
+  }
+
+  ///Bundles from random sources to random destinations
+  traffic_rng = splitmix(&rng);
+  overhear_rng = splitmix(&rng);
+  bundles = calloc(P.bundles, sizeof(struct bundle));
+  latencies = calloc(P.bundles, sizeof(double));
+  bundle_by_key = malloc(P.nodes * 256 * sizeof(int));
+  memset(bundle_by_key, 0xff, P.nodes * 256 * sizeof(int));
+  create_until = P.create_until * CLOCK_SECOND;
+  for(i = 0; i < P.bundles && P.nodes > 1; i++) {
+    src = splitmix(&traffic_rng) % P.nodes;
+    do {
+      dest = splitmix(&traffic_rng) % P.nodes;
+    } while(dest == src);
+    push(splitmix(&traffic_rng) % (create_until + 1), EV_CREATE, src, dest, NULL);
+  }
+
+  while(heap_len > 0 && heap[0].time <= end) {
+    e = pop();
+    now = e.time;
+    switch(e.type) {
+    case EV_WAKE:
+      if(nodes[e.node].wake != e.time) {
+        break;
+      }
+      nodes[e.node].wake = SIM_NEVER;
+      swap_in(e.node);
+      run_node(e.node);
+      break;
+    case EV_RX:
+      {
+        struct frame *f = e.ptr;
+        rimeaddr_t from;
+        ///Nothing is heard with the radio off or tuned elsewhere
+        if(tuned(e.node, f) && clear(e.node, f)) {
+          sim_addr(f->from, &from);
+          swap_in(e.node);
+          node_receive(f->kind, f->channel, &from, f->data, f->len, f->seqno);
+          run_node(e.node);
+        }
+        release(f);
+      }
+      break;
+    case EV_RUNICAST:
+      runicast_attempt(e.node, e.ptr);
+      break;
+    case EV_CREATE:
+      {
+        rimeaddr_t addr;
+        swap_in(e.node);
+        ///Keyed on the sequence number create_message() is about to use
+        bundles[S.created].created = now;
+        bundle_by_key[e.node * 256 + ++nodes[e.node].seq] = S.created;
+        sim_addr(e.peer, &addr);
+        node_create(&addr, P.copies);
+        S.created++;
+        run_node(e.node);
+      }
+      break;
+    }
+  }
+
+  now = end;
+  for(i = 0; i < P.nodes; i++) {
+    swap_in(i);
+    node_counters(&unicasts, &acks, &timeouts);
+    S.unicasts += unicasts;
+    S.acks += acks;
+    S.timeouts += timeouts;
+    sim_radio_power(0);
+    S.radio_on += nodes[i].radio_on / (double)end / P.nodes;
+  }
+  if(S.delivered > 0) {
+    qsort(latencies, S.delivered, sizeof(double), cmp_double);
+    for(i = 0; i < S.delivered; i++) {
+      S.latency_mean += latencies[i] / S.delivered;
+    }
+    S.latency_p50 = latencies[S.delivered / 2];
+    S.latency_p95 = latencies[(int)(S.delivered * 0.95)];
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_param(struct params *p, const char *name, const char *value)
+{
+  if(!strcmp(name, "nodes")) {
+    p->nodes = atoi(value);
+  }
+  else if(!strcmp(name, "time")) {
+    p->duration = atof(value);
+  }
+  else if(!strcmp(name, "bundles")) {
+    p->bundles = atoi(value);
+  }
+  else if(!strcmp(name, "create")) {
+    p->create_until = atof(value);
+  }
+  else if(!strcmp(name, "L")) {
+    p->copies = atoi(value);
+  }
+  else if(!strcmp(name, "area")) {
+    p->area = atof(value);
+  }
+  else if(!strcmp(name, "range")) {
+    p->range = atof(value);
+  }
+  else if(!strcmp(name, "loss")) {
+    p->loss = atof(value);
+  }
+  else if(!strcmp(name, "speed")) {
+    if(sscanf(value, "%lf:%lf", &p->vmin, &p->vmax) != 2) {
+      return 0;
+    }
+  }
+  else if(!strcmp(name, "pause")) {
+    p->pause = atof(value);
+  }
+  else if(!strcmp(name, "beacon")) {
+    if(sscanf(value, "%lf:%lf", &p->beacon_min, &p->beacon_spread) != 2) {
+      return 0;
+    }
+  }
+  else if(!strcmp(name, "collisions")) {
+    p->collisions = atoi(value);
+  }
+  else if(!strcmp(name, "mobility")) {
+    if(!strcmp(value, "rwp")) {
+      p->mobility = MOBILITY_RWP;
+    }
+    else if(!strcmp(value, "static")) {
+      p->mobility = MOBILITY_STATIC;
+    }
+    else if(!strncmp(value, "trace:", 6)) {
+      p->mobility = MOBILITY_TRACE;
+      snprintf(p->trace, sizeof(p->trace), "%s", value + 6);
+    }
+    else {
+      return 0;
+    }
+  }
+  else {
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_conf(FILE *out, int point, int rep, const struct params *p)
+{
+  static const char *models[] = {"rwp", "static", "trace"};
+  fprintf(out, "[SIM-CONF] point=%d rep=%d seed=%llu nodes=%d time=%g bundles=%d create=%g L=%d"
+          " area=%g range=%g loss=%g speed=%g:%g pause=%g beacon=%g:%g mobility=%s%s%s messages=%d"
+          " collisions=%d\n",
+          point, rep, p->seed, p->nodes, p->duration, p->bundles, p->create_until, p->copies,
+          p->area, p->range, p->loss, p->vmin, p->vmax, p->pause, p->beacon_min, p->beacon_spread,
+          models[p->mobility], p->mobility == MOBILITY_TRACE ? ":" : "",
+          p->mobility == MOBILITY_TRACE ? p->trace : "", MAX_MESSAGES, p->collisions);
+}
+static void
+print_stats(FILE *out, int point, int rep, const struct stats *s)
+{
+  fprintf(out, "[SIM-STATS] point=%d rep=%d created=%d delivered=%d ratio=%.4f duplicates=%d"
+          " latency_mean=%.2f latency_p50=%.2f latency_p95=%.2f beacons=%ld runicasts=%ld"
+          " unicasts=%ld announcements=%ld bundles_sent=%ld acks=%ld timeouts=%ld radio_on=%.4f"
+          " collisions=%ld\n",
+          point, rep, s->created, s->delivered, s->created ? s->delivered / (double)s->created : 0,
+          s->duplicates, s->latency_mean, s->latency_p50, s->latency_p95,
+          s->frames[SIM_BROADCAST], s->frames[SIM_RUNICAST], s->frames[SIM_UNICAST],
+          s->frames[SIM_ANNOUNCEMENT], s->unicasts, s->acks, s->timeouts, s->radio_on,
+          s->collisions);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct params base = {100, 3600, 100, -1, 4, 1000, 50, 0, 0.5, 2, 0, 2, 5, MOBILITY_RWP, "", 1};
+  char *sweep_name[MAX_SWEEPS], *sweep_value[MAX_SWEEPS][MAX_SWEEP_VALUES], *v;
+  int sweep_len[MAX_SWEEPS], sweeps = 0, reps = 1, jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *outdir = "sim-out";
+  char path[512];
+  struct stats *results;
+  struct params *points;
+  int npoints, point, running = 0, next = 0, failed = 0, opt, i, k, status;
+  pid_t pid;
+
+  while((opt = getopt(argc, argv, "n:t:b:c:L:a:r:p:v:w:B:m:s:R:j:o:CS:h")) != -1) {
+    switch(opt) {
+    case 'n': set_param(&base, "nodes", optarg); break;
+    case 't': set_param(&base, "time", optarg); break;
+    case 'b': set_param(&base, "bundles", optarg); break;
+    case 'c': set_param(&base, "create", optarg); break;
+    case 'L': set_param(&base, "L", optarg); break;
+    case 'a': set_param(&base, "area", optarg); break;
+    case 'r': set_param(&base, "range", optarg); break;
+    case 'p': set_param(&base, "loss", optarg); break;
+    case 'v':
+      if(!set_param(&base, "speed", optarg)) {
+        goto usage;
+      }
+      break;
+    case 'w': set_param(&base, "pause", optarg); break;
+    case 'B':
+      if(!set_param(&base, "beacon", optarg)) {
+        goto usage;
+      }
+      break;
+    case 'm':
+      if(!set_param(&base, "mobility", optarg)) {
+        goto usage;
+      }
+      break;
+    case 's': base.seed = strtoull(optarg, NULL, 0); break;
+    case 'C': base.collisions = 1; break;
+    case 'R': reps = atoi(optarg); break;
+    case 'j': jobs = atoi(optarg); break;
+    case 'o': outdir = optarg; break;
+    case 'S':
+      if(sweeps == MAX_SWEEPS || (v = strchr(optarg, '=')) == NULL) {
+        goto usage;
+      }
+      *v++ = '\0';
+      sweep_name[sweeps] = optarg;
+      for(k = 0, v = strtok(v, ","); v != NULL && k < MAX_SWEEP_VALUES; v = strtok(NULL, ",")) {
+        sweep_value[sweeps][k++] = v;
+      }
+      if(k == 0 || !set_param(&base, sweep_name[sweeps], sweep_value[sweeps][0])) {
+        goto usage;
+      }
+      sweep_len[sweeps++] = k;
+      break;
+    default:
+      goto usage;
+    }
+  }
+  if(base.nodes < 1 || base.nodes > MAX_NODES || reps < 1) {
+    goto usage;
+  }
+  if(base.create_until < 0) {
+    base.create_until = base.duration / 2;
+  }
+  if(jobs < 1) {
+    jobs = 1;
+  }
+
+  ///Every combination of the swept values, times the repetitions
+  npoints = reps;
+  for(i = 0; i < sweeps; i++) {
+    npoints *= sweep_len[i];
+  }
+  points = malloc(npoints * sizeof(struct params));
+  for(point = 0; point < npoints; point++) {
+    points[point] = base;
+    for(i = 0, k = point / reps; i < sweeps; i++) {
+      set_param(&points[point], sweep_name[i], sweep_value[i][k % sweep_len[i]]);
+      k /= sweep_len[i];
+    }
+    if(points[point].nodes < 1 || points[point].nodes > MAX_NODES) {
+      fprintf(stderr, "point %d: nodes must be between 1 and %d\n", point, MAX_NODES);
+      return 1;
+    }
+    ///Derived from the base seed and the point alone, so -j does not change the numbers
+    points[point].seed = base.seed + 0x9e3779b97f4a7c15ULL * (point + 1);
+    points[point].seed = splitmix(&points[point].seed);
+  }
+  mkdir(outdir, 0755);
+  results = mmap(NULL, npoints * sizeof(struct stats), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  ///Keep the image the program was loaded with, every node starts from it
+  data_size = __stop_dtn_node_data - __start_dtn_node_data;
+  bss_size = __stop_dtn_node_bss - __start_dtn_node_bss;
+  pristine = malloc(data_size);
+  memcpy(pristine, __start_dtn_node_data, data_size);
+  fflush(stdout);
+
+  while(next < npoints || running > 0) {
+    if(next < npoints && running < jobs) {
+      point = next++;
+      pid = fork();
+      if(pid == 0) {
+        snprintf(path, sizeof(path), "%s/point-%d.log", outdir, point);
+        if(freopen(path, "w", stdout) == NULL) {
+          perror(path);
+          _exit(1);
+        }
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+        P = points[point];
+        print_conf(stdout, point, point % reps, &P);
+        if(!simulate()) {
+          _exit(1);
+        }
+        print_stats(stdout, point, point % reps, &S);
+        results[point] = S;
+        fflush(stdout);
+        _exit(0);
+      }
+      if(pid < 0) {
+        perror("fork");
+        return 1;
+      }
+      running++;
+      continue;
+    }
+    if(wait(&status) > 0) {
+      running--;
+      if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        failed++;
+      }
+    }
+  }
+  for(point = 0; point < npoints; point++) {
+    print_conf(stdout, point, point % reps, &points[point]);
+    print_stats(stdout, point, point % reps, &results[point]);
+  }
+  if(failed) {
+    fprintf(stderr, "%d points failed\n", failed);
+  }
+  return failed ? 1 : 0;
+
+usage:
+  fprintf(stderr, "usage: %s [-n nodes] [-t seconds] [-b bundles] [-c seconds] [-L copies]"
+          " [-a metres] [-r metres] [-p loss] [-v min:max] [-w pause] [-B min:spread]"
+          " [-m rwp|static|trace:FILE] [-s seed] [-R reps] [-j jobs] [-o dir] [-C]"
+          " [-S name=v1,v2,...]\n"
+          "sweepable names: nodes time bundles create L area range loss speed pause"
+          " beacon mobility collisions\n", argv[0]);
+  return 2;
+}
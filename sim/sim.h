@@ -0,0 +1,58 @@
+/**
+ * @file sim.h
+ * @author Archie Norman
+ * @brief Between the simulator (sim.c) and the node side (node.c). node.c is
+ * linked with dtn.c and the protocol modules in to one object whose .data
+ * and .bss are renamed to dtn_node_data and dtn_node_bss, the simulator
+ * keeps a copy of those sections per node and swaps the right one in before
+ * it calls in to the node side, the same trick Cooja uses for its native
+ * Contiki motes. Everything in node.c is per node, everything in sim.c is
+ * shared.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+#include "contiki.h"
+#include "net/rime.h"
+#include "dtn.h"
+
+///No timer pending
+#define SIM_NEVER ((clock_time_t)-1)
+
+/*
+ *Called by the node side
+ */
+///The simulation clock
+clock_time_t sim_now(void);
+///The address of a node
+void sim_addr(uint16_t node, rimeaddr_t *addr);
+///The node currently swapped in
+uint16_t sim_current(void);
+///Hand a frame to the radio model, to is NULL for broadcasts
+void sim_radio_send(uint8_t kind, struct sim_conn *conn, const rimeaddr_t *to,
+                    const void *data, uint16_t len, uint8_t max_retransmissions);
+///A bundle reached its destination
+void sim_delivered(const dtn_message *message);
+///The node switched its radio on or off
+void sim_radio_power(int on);
+///The node retuned its radio, it only hears frames sent on the same frequency
+void sim_radio_frequency(uint8_t freq);
+///The node added a Rime sniffer, so it wants runicasts to other nodes
+void sim_sniffing(void);
+
+/*
+ *Called by the simulator with the node swapped in
+ */
+void node_boot(uint16_t node, unsigned short seed);
+///Runs whatever is due and returns when the node next needs to run
+clock_time_t node_run(void);
+void node_receive(uint8_t kind, uint16_t channel, const rimeaddr_t *from,
+                  const void *data, uint16_t len, uint8_t seqno);
+///A runicast to another node was overheard
+void node_overhear(uint16_t channel, const rimeaddr_t *from, const rimeaddr_t *to,
+                   const void *data, uint16_t len);
+void node_runicast_done(struct sim_conn *conn, const rimeaddr_t *to, int acked,
+                        uint8_t retransmissions);
+void node_create(const rimeaddr_t *dest, uint8_t copies);
+void node_counters(int *unicasts, int *acks, int *timeouts);
+
+#endif /* __SIM_H__ */
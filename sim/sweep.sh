@@ -0,0 +1,16 @@
+#!/bin/bash
+###Sweep L, the beacon interval and the cache size on the host simulator
+###usage: ./sweep.sh [output file] [extra dtn-sim options]
+###The cache size is fixed at build time, so dtn-sim is rebuilt for each one,
+###the other parameters are swept by dtn-sim itself on every core.
+file=${1:-sweep_output.txt}
+shift
+sizes="5 10 20 50"
+> $file
+for msgs in $sizes;
+do
+    make clean > /dev/null
+    make MESSAGES=$msgs > /dev/null || exit 1
+    ./dtn-sim -n 500 -t 3600 -b 500 -a 2000 -r 80 -R 3 -o sim-out/messages-$msgs \
+        -S L=1,2,4,8,16 -S beacon=2:5,5:10,10:20 "$@" | grep -a "SIM-" >> $file
+done
@@ -0,0 +1,445 @@
+/**
+ * @file dtn-collector.c
+ * @author Archie Norman
+ * @brief Host side collector for the DTN sink (see dtn-sink.h). Reads SLIP
+ * batches from the sink's serial port, writes one [SINK] line per bundle and
+ * acknowledges each batch so the sink can free it. Build with
+ * "make dtn-collector" from the project directory.
+ *
+ *   dtn-collector [-B baud] [-o file] <device>   collect from a node
+ *   dtn-collector -s [-n bundles] <device>       act as a sink, for testing
+ *   dtn-collector -l [-n bundles]                collector and test sink on a pty pair
+ *
+ * Sending SIGUSR1 toggles a pause, batches are still stored and acknowledged
+ * but the sink is told to hold off, e.g. while the output file is rotated.
+ * Addresses are two bytes, as set by RIMEADDR_CONF_SIZE in project-conf.h.
+ */
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define FRAME_BATCH 'D'
+#define FRAME_ACK   'A'
+#define FRAME_RESET 'R'
+#define ACK_OK      0
+#define ACK_BUSY    1
+#define ACK_RESEND  2
+
+#define ADDR_LEN   2
+#define MAX_MSG    255
+#define MAX_FRAME  2048
+///Sensor bundles, as DTN_SAMPLE_MAGIC and DTN_SAMPLE_HEADER_LEN in dtn-sample.h
+#define SAMPLE_MAGIC      0xd5
+#define SAMPLE_HEADER_LEN 8
+
+static FILE *out;
+static volatile sig_atomic_t paused;
+/*---------------------------------------------------------------------------*/
+/* Same as crc16_add() in Contiki's core/lib/crc16.c */
+static uint16_t
+crc16_add(uint8_t b, uint16_t acc)
+{
+  acc ^= b;
+  acc  = (acc >> 8) | (acc << 8);
+  acc ^= (acc & 0xff00) << 4;
+  acc ^= (acc >> 8) >> 4;
+  acc ^= (acc & 0xff00) >> 5;
+  return acc;
+}
+static uint16_t
+crc16_data(const uint8_t *data, int len)
+{
+  uint16_t acc = 0;
+  while(len-- > 0) {
+    acc = crc16_add(*data++, acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_all(int fd, const uint8_t *buf, int len)
+{
+  int n;
+  while(len > 0) {
+    n = write(fd, buf, len);
+    if(n < 0) {
+      if(errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      perror("write");
+      exit(1);
+    }
+    buf += n;
+    len -= n;
+  }
+}
+/*
+ * @brief SLIP encode a frame, appending its crc, and write it out
+ */
+static void
+send_frame(int fd, const uint8_t *frame, int len)
+{
+  uint8_t buf[2 * MAX_FRAME + 6];
+  uint16_t crc;
+  int i, n = 0;
+  uint8_t c;
+
+  crc = crc16_data(frame, len);
+  buf[n++] = SLIP_END;
+  for(i = 0; i < len + 2; i++) {
+    c = i < len ? frame[i] : i == len ? (crc & 0xff) : (crc >> 8);
+    if(c == SLIP_END) {
+      buf[n++] = SLIP_ESC;
+      c = SLIP_ESC_END;
+    } else if(c == SLIP_ESC) {
+      buf[n++] = SLIP_ESC;
+      c = SLIP_ESC_ESC;
+    }
+    buf[n++] = c;
+  }
+  buf[n++] = SLIP_END;
+  write_all(fd, buf, n);
+}
+/*
+ * @brief Read the next intact frame, without its crc
+ * @return the frame length, 0 on timeout, -1 at end of input
+ */
+static int
+read_frame(int fd, uint8_t *frame, int timeout_ms)
+{
+  static uint8_t buf[MAX_FRAME + 2];
+  static int len, esc, overflow;
+  struct timeval tv;
+  fd_set fds;
+  uint8_t c;
+  int n;
+
+  while(1) {
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    n = select(fd + 1, &fds, NULL, NULL, timeout_ms < 0 ? NULL : &tv);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      return n;
+    }
+    n = read(fd, &c, 1);
+    if(n < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if(n <= 0) {
+      return -1;
+    }
+    if(c == SLIP_END) {
+      n = len;
+      len = esc = 0;
+      ///Debug text between frames ends up here too, the crc sorts it out
+      if(!overflow && n > 2 && crc16_data(buf, n - 2) == (buf[n - 2] | (buf[n - 1] << 8))) {
+        memcpy(frame, buf, n - 2);
+        return n - 2;
+      }
+      overflow = 0;
+      continue;
+    }
+    if(esc) {
+      esc = 0;
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      continue;
+    }
+    if(len < (int)sizeof(buf)) {
+      buf[len++] = c;
+    } else {
+      overflow = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_ack(int fd, uint8_t seq, uint8_t status)
+{
+  uint8_t ack[3] = {FRAME_ACK, seq, status};
+  send_frame(fd, ack, sizeof(ack));
+}
+/*
+ * @brief Write out a sensor bundle (see dtn-sample.h), one value per reading
+ * @param1 - the payload
+ * @param2 - the payload length
+ * @param3 - the bundle timestamp, when the batch was sealed
+ * @return 0 if the payload is not a sensor batch
+ */
+static int
+print_samples(const uint8_t *p, int len, uint32_t timestamp)
+{
+  int i, n, shift;
+  uint16_t z;
+  int16_t value;
+
+  if(len < SAMPLE_HEADER_LEN || p[0] != SAMPLE_MAGIC) {
+    return 0;
+  }
+  value = p[6] | (p[7] << 8);
+  fprintf(out, "samples sensor %d every %ds from ts %lu: %d", p[1], p[3],
+    (unsigned long)(timestamp - (p[4] | (p[5] << 8))), value);
+  for(i = SAMPLE_HEADER_LEN, n = 1; n < p[2] && i < len; n++) {
+    for(z = 0, shift = 0; i < len; shift += 7) {
+      z |= (p[i] & 0x7f) << shift;
+      if(!(p[i++] & 0x80)) {
+        break;
+      }
+    }
+    value += (z >> 1) ^ -(z & 1);
+    fprintf(out, " %d", value);
+  }
+  return 1;
+}
+/*
+ * @brief Write out the bundles of a batch
+ * @return 1 if the batch was well formed and stored
+ */
+static int
+store_batch(const uint8_t *frame, int len)
+{
+  const uint8_t *p = frame + 3, *end = frame + len;
+  char msg[MAX_MSG + 1];
+  uint32_t timestamp;
+  int i, count = frame[2];
+
+  ///Check the whole batch before writing any of it
+  for(i = 0; i < count; i++) {
+    if(p + 3 * ADDR_LEN + 7 > end || p + 3 * ADDR_LEN + 7 + p[3 * ADDR_LEN + 6] > end) {
+      return 0;
+    }
+    p += 3 * ADDR_LEN + 7 + p[3 * ADDR_LEN + 6];
+  }
+  for(p = frame + 3, i = 0; i < count; i++) {
+    timestamp = p[8] | (p[9] << 8) | (p[10] << 16) | ((uint32_t)p[11] << 24);
+    fprintf(out, "[SINK] <%d.%d:%d.%d:%d> from %d.%d copies %d ts %lu ",
+      p[2], p[3], p[4], p[5], p[6], p[0], p[1], p[7], (unsigned long)timestamp);
+    if(!print_samples(p + 13, p[12], timestamp)) {
+      memcpy(msg, p + 13, p[12]);
+      msg[p[12]] = '\0';
+      fprintf(out, "msg \"%s\"", msg);
+    }
+    fprintf(out, " --%ld\n", (long)time(NULL));
+    p += 13 + p[12];
+  }
+  return fflush(out) == 0;
+}
+/*
+ * @brief The collector, runs until the device closes
+ */
+static int
+collect(int fd)
+{
+  uint8_t frame[MAX_FRAME];
+  int len, last_seq = -1;
+  unsigned long batches = 0, dups = 0;
+
+  while((len = read_frame(fd, frame, -1)) >= 0) {
+    ///The sink restarted, its batch seq starts again and is no repeat of ours
+    if(len == 2 && frame[0] == FRAME_RESET) {
+      last_seq = -1;
+      send_ack(fd, frame[1], ACK_OK);
+      continue;
+    }
+    if(len < 3 || frame[0] != FRAME_BATCH) {
+      continue;
+    }
+    ///A repeat means our ack was lost, it is already stored so just ack again
+    if(frame[1] == last_seq) {
+      dups++;
+    } else if(store_batch(frame, len)) {
+      last_seq = frame[1];
+      batches++;
+    } else {
+      ///Could not store it, no ack so the sink keeps the bundles and tries again
+      continue;
+    }
+    send_ack(fd, frame[1], paused ? ACK_BUSY : ACK_OK);
+  }
+  fprintf(stderr, "dtn-collector: %lu batches, %lu repeats\n", batches, dups);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * @brief Stand in for a sink node, sends numbered bundles in batches of
+ * four and resends each batch until it is acknowledged
+ */
+static int
+stand_in_sink(int fd, int bundles)
+{
+  uint8_t frame[MAX_FRAME], ack[MAX_FRAME];
+  int n = 0, i, len, count, retries = 0;
+  uint8_t seq = 0;
+  uint8_t *p;
+
+  ///A sink after boot, the collector may still remember an earlier run's seq
+  frame[0] = FRAME_RESET;
+  frame[1] = seq;
+  do {
+    send_frame(fd, frame, 2);
+    len = read_frame(fd, ack, 1000);
+    if(len < 0) {
+      return 1;
+    }
+  } while(len != 3 || ack[0] != FRAME_ACK || ack[1] != seq);
+
+  while(n < bundles) {
+    count = bundles - n < 4 ? bundles - n : 4;
+    p = frame;
+    *p++ = FRAME_BATCH;
+    *p++ = seq;
+    *p++ = count;
+    for(i = 0; i < count; i++) {
+      *p++ = 128; *p++ = 2;                       /* from */
+      *p++ = 128; *p++ = 1 + (n + i) % 8;         /* src */
+      *p++ = 128; *p++ = 9;                       /* dest */
+      *p++ = (n + i) & 0xff;                      /* seq */
+      *p++ = 1;                                   /* copies */
+      *p++ = (n + i) & 0xff; *p++ = 0; *p++ = 0; *p++ = 0;
+      *p++ = 4;
+      memcpy(p, "arch", 4);
+      p += 4;
+    }
+    len = p - frame;
+    send_frame(fd, frame, len);
+    len = read_frame(fd, ack, 1000);
+    if(len == 3 && ack[0] == FRAME_ACK && ack[1] == seq && ack[2] != ACK_RESEND) {
+      n += count;
+      seq++;
+      if(ack[2] == ACK_BUSY) {
+        sleep(1);
+      }
+    } else if(len < 0) {
+      break;
+    } else {
+      retries++;
+    }
+  }
+  fprintf(stderr, "dtn-collector: stand in sink sent %d bundles, %d retries\n", n, retries);
+  return n == bundles ? 0 : 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+toggle_pause(int sig)
+{
+  (void)sig;
+  paused = !paused;
+}
+static speed_t
+baud_rate(int baud)
+{
+  switch(baud) {
+  case 9600: return B9600;
+  case 19200: return B19200;
+  case 38400: return B38400;
+  case 57600: return B57600;
+  case 230400: return B230400;
+  case 460800: return B460800;
+  case 921600: return B921600;
+  default: return B115200;
+  }
+}
+static void
+raw_mode(int fd, int baud)
+{
+  struct termios tty;
+  if(tcgetattr(fd, &tty) < 0) {
+    return;
+  }
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, baud_rate(baud));
+  cfsetospeed(&tty, baud_rate(baud));
+  tty.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(fd, TCSANOW, &tty);
+}
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: dtn-collector [-B baud] [-o file] <device>\n"
+                  "       dtn-collector -s [-n bundles] <device>\n"
+                  "       dtn-collector -l [-n bundles]\n");
+  exit(2);
+}
+int
+main(int argc, char **argv)
+{
+  int c, fd, sfd, baud = 115200, stand_in = 0, loopback = 0, bundles = 100, status;
+  const char *device;
+  pid_t child;
+
+  out = stdout;
+  while((c = getopt(argc, argv, "B:o:sln:")) != -1) {
+    switch(c) {
+    case 'B': baud = atoi(optarg); break;
+    case 'o':
+      out = fopen(optarg, "a");
+      if(out == NULL) {
+        perror(optarg);
+        return 1;
+      }
+      break;
+    case 's': stand_in = 1; break;
+    case 'l': loopback = 1; break;
+    case 'n': bundles = atoi(optarg); break;
+    default: usage();
+    }
+  }
+  signal(SIGUSR1, toggle_pause);
+
+  if(loopback) {
+    ///Collector on the master side of a pty, the stand in sink on the slave side
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+      perror("pty");
+      return 1;
+    }
+    device = ptsname(fd);
+    child = fork();
+    if(child == 0) {
+      sfd = open(device, O_RDWR | O_NOCTTY);
+      if(sfd < 0) {
+        perror(device);
+        _exit(1);
+      }
+      raw_mode(sfd, baud);
+      _exit(stand_in_sink(sfd, bundles));
+    }
+    collect(fd);
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+  }
+
+  if(optind >= argc) {
+    usage();
+  }
+  device = argv[optind];
+  fd = open(device, O_RDWR | O_NOCTTY);
+  if(fd < 0) {
+    perror(device);
+    return 1;
+  }
+  raw_mode(fd, baud);
+  return stand_in ? stand_in_sink(fd, bundles) : collect(fd);
+}
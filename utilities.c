@@ -1,8 +1,9 @@
 #include <stdio.h>
 
+clock_time_t
 convert_time(clock_time_t time){
   return time / 100;
-};
+}
 
 
 /** PRINT NEIGHBORS **/